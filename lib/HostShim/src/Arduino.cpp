@@ -0,0 +1,156 @@
+#include "Arduino.h"
+#include "esp_partition.h"
+#include <stdarg.h>
+#include <ctype.h>
+#include <chrono>
+#include <thread>
+#include <random>
+
+#ifndef HOST_FREE_HEAP
+#define HOST_FREE_HEAP (160 * 1024) // Free heap of the CYD firmware after boot
+#endif
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// --- String ---
+
+bool String::equalsIgnoreCase(const String& other) const {
+    if (s.size() != other.s.size()) return false;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (tolower((unsigned char)s[i]) != tolower((unsigned char)other.s[i])) return false;
+    }
+    return true;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+}
+
+String String::substring(unsigned from, unsigned to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s.size()) return String();
+    return String(s.substr(from, to - from));
+}
+
+void String::trim() {
+    size_t first = 0;
+    while (first < s.size() && isspace((unsigned char)s[first])) first++;
+    size_t last = s.size();
+    while (last > first && isspace((unsigned char)s[last - 1])) last--;
+    s = s.substr(first, last - first);
+}
+
+void String::toLowerCase() {
+    for (auto& c : s) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (auto& c : s) c = (char)toupper((unsigned char)c);
+}
+
+void String::replace(const String& find, const String& with) {
+    if (find.s.empty()) return;
+    size_t pos = 0;
+    while ((pos = s.find(find.s, pos)) != std::string::npos) {
+        s.replace(pos, find.s.size(), with.s);
+        pos += with.s.size();
+    }
+}
+
+std::string String::format(unsigned long long value, unsigned char base) {
+    if (base < 2 || base > 36) base = DEC;
+    char digits[65];
+    int i = 64;
+    digits[i] = '\0';
+    do {
+        int d = (int)(value % base);
+        digits[--i] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+        value /= base;
+    } while (value);
+    return std::string(digits + i);
+}
+
+std::string String::format(long long value, unsigned char base) {
+    if (value < 0 && base == DEC) return "-" + format((unsigned long long)(-(value + 1)) + 1, base);
+    return format((unsigned long long)value, base);
+}
+
+std::string String::format(double value, unsigned char decimals) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", decimals, value);
+    return text;
+}
+
+// --- Print ---
+
+size_t Print::printf(const char* format, ...) {
+    char small[128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+
+    std::string large(n + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&large[0], large.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)large.data(), n);
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t size) {
+    return fwrite(data, 1, size, stdout);
+}
+
+// --- Clock ---
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() { return (unsigned long)esp_timer_get_time(); }
+unsigned long millis() { return (unsigned long)(esp_timer_get_time() / 1000); }
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+void yield() { std::this_thread::yield(); }
+
+uint32_t EspClass::getCycleCount() {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - bootTime).count();
+    return (uint32_t)((uint64_t)ns * 240 / 1000);
+}
+
+uint32_t EspClass::getFreeHeap() { return HOST_FREE_HEAP; }
+uint32_t EspClass::getMaxAllocHeap() { return HOST_FREE_HEAP / 2; }
+
+// --- Random ---
+
+static std::minstd_rand randomEngine;
+
+void randomSeed(unsigned long seed) { randomEngine.seed((std::minstd_rand::result_type)seed); }
+
+long random(long max) {
+    if (max <= 0) return 0;
+    return (long)(randomEngine() % (unsigned long)max);
+}
+
+long random(long min, long max) {
+    if (min >= max) return min;
+    return min + random(max - min);
+}
+
+// --- Partitions ---
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char*) {
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t*, size_t, void*, size_t) { return ESP_FAIL; }
+
+esp_err_t esp_partition_mmap(const esp_partition_t*, size_t, size_t, spi_flash_mmap_memory_t, const void**, spi_flash_mmap_handle_t*) {
+    return ESP_FAIL;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t) {}
@@ -0,0 +1,163 @@
+#ifndef HOSTSHIM_ARDUINO_H
+#define HOSTSHIM_ARDUINO_H
+
+// Host stand-in for the parts of Arduino-ESP32 the audio path uses (env:native).
+// Only built for the native platform (library.json). Not meant to be complete:
+// add what a new test needs, the same way the real core behaves.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define DEC 10
+#define HEX 16
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+using std::abs;
+
+class String {
+public:
+    String() {}
+    String(const char* text) : s(text ? text : "") {}
+    String(const std::string& text) : s(text) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int value, unsigned char base = DEC) : s(format((long long)value, base)) {}
+    explicit String(unsigned value, unsigned char base = DEC) : s(format((unsigned long long)value, base)) {}
+    explicit String(long value, unsigned char base = DEC) : s(format((long long)value, base)) {}
+    explicit String(unsigned long value, unsigned char base = DEC) : s(format((unsigned long long)value, base)) {}
+    explicit String(long long value, unsigned char base = DEC) : s(format(value, base)) {}
+    explicit String(unsigned long long value, unsigned char base = DEC) : s(format(value, base)) {}
+    explicit String(float value, unsigned char decimals = 2) : s(format((double)value, decimals)) {}
+    explicit String(double value, unsigned char decimals = 2) : s(format(value, decimals)) {}
+
+    unsigned length() const { return (unsigned)s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    bool isEmpty() const { return s.empty(); }
+    void reserve(unsigned size) { s.reserve(size); }
+
+    char charAt(unsigned index) const { return index < s.size() ? s[index] : 0; }
+    char operator[](unsigned index) const { return charAt(index); }
+
+    bool equals(const String& other) const { return s == other.s; }
+    bool equalsIgnoreCase(const String& other) const;
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String& suffix) const;
+
+    int indexOf(char c, unsigned from = 0) const { return found(s.find(c, from)); }
+    int indexOf(const String& text, unsigned from = 0) const { return found(s.find(text.s, from)); }
+    int lastIndexOf(char c) const { return found(s.rfind(c)); }
+    int lastIndexOf(const String& text) const { return found(s.rfind(text.s)); }
+
+    String substring(unsigned from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const;
+
+    void trim();
+    void toLowerCase();
+    void toUpperCase();
+    void replace(const String& find, const String& with);
+    void remove(unsigned index, unsigned count = (unsigned)-1) { if (index < s.size()) s.erase(index, count); }
+
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return (float)atof(s.c_str()); }
+
+    String& operator+=(const String& other) { s += other.s; return *this; }
+    String& operator+=(const char* other) { s += other ? other : ""; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    String& operator+=(int value) { s += format((long long)value, DEC); return *this; }
+    String& operator+=(unsigned value) { s += format((unsigned long long)value, DEC); return *this; }
+    String& operator+=(long value) { s += format((long long)value, DEC); return *this; }
+    String& operator+=(unsigned long value) { s += format((unsigned long long)value, DEC); return *this; }
+    bool concat(const String& other) { s += other.s; return true; }
+
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* other) const { return s == (other ? other : ""); }
+    bool operator!=(const String& other) const { return s != other.s; }
+    bool operator!=(const char* other) const { return !(*this == other); }
+    bool operator<(const String& other) const { return s < other.s; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+    friend String operator+(const String& a, const char* b) { return String(a.s + (b ? b : "")); }
+    friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b.s); }
+    friend String operator+(const String& a, char b) { return String(a.s + b); }
+    friend String operator+(const String& a, int b) { return a + String(b); }
+    friend String operator+(const String& a, unsigned b) { return a + String(b); }
+    friend String operator+(const String& a, long b) { return a + String(b); }
+    friend String operator+(const String& a, unsigned long b) { return a + String(b); }
+
+private:
+    std::string s;
+
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    static std::string format(long long value, unsigned char base);
+    static std::string format(unsigned long long value, unsigned char base);
+    static std::string format(double value, unsigned char decimals);
+};
+
+// Text output, shared by Serial and fs::File
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t* data, size_t size) = 0;
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+    size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned value, int base = DEC) { return print(String(value, base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(long long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(unsigned long long value, int base = DEC) { return print(String(value, base)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+
+    template <typename T> size_t println(const T& value) { return print(value) + println(); }
+    template <typename T> size_t println(const T& value, int format) { return print(value, format) + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// Serial goes to stdout
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    using Print::write;
+    size_t write(const uint8_t* data, size_t size) override;
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();    // A typical CYD value (HOST_FREE_HEAP), the host has plenty
+    uint32_t getMaxAllocHeap();
+    uint32_t getCycleCount();  // The host clock counted at 240 MHz
+    uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+#endif
@@ -0,0 +1,223 @@
+#include "FS.h"
+#include "LittleFS.h"
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+LittleFSFS LittleFS;
+
+namespace fs {
+
+class FileImpl {
+public:
+    std::string devicePath;
+    std::string baseName;
+    std::string hostPath;
+    FILE* file = nullptr;
+    bool directory = false;
+    std::vector<std::string> entries; // Directory: names, read by openNextFile()
+    size_t nextEntry = 0;
+
+    ~FileImpl() {
+        if (file) fclose(file);
+    }
+};
+
+File::operator bool() const {
+    return impl && (impl->file || impl->directory);
+}
+
+size_t File::write(const uint8_t* data, size_t size) {
+    if (!impl || !impl->file) return 0;
+    return fwrite(data, 1, size, impl->file);
+}
+
+int File::available() {
+    if (!impl || !impl->file) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    if (!impl || !impl->file) return -1;
+    return fgetc(impl->file);
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!impl || !impl->file) return 0;
+    return fread(buffer, 1, size, impl->file);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl || !impl->file) return false;
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(impl->file, pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!impl || !impl->file) return 0;
+    long pos = ftell(impl->file);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!impl || !impl->file) return 0;
+    fflush(impl->file);
+    struct stat info;
+    if (fstat(fileno(impl->file), &info) != 0) return 0;
+    return (size_t)info.st_size;
+}
+
+void File::flush() {
+    if (impl && impl->file) fflush(impl->file);
+}
+
+void File::close() {
+    impl.reset();
+}
+
+const char* File::path() const {
+    return impl ? impl->devicePath.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    return impl ? impl->baseName.c_str() : nullptr;
+}
+
+bool File::isDirectory() const {
+    return impl && impl->directory;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!impl || !impl->directory || impl->nextEntry >= impl->entries.size()) return File();
+    std::string path = impl->devicePath;
+    if (path.empty() || path[path.size() - 1] != '/') path += '/';
+    path += impl->entries[impl->nextEntry++];
+    return LittleFS.open(path.c_str(), mode);
+}
+
+String File::readStringUntil(char terminator) {
+    std::string text;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) text += (char)c;
+    return String(text);
+}
+
+String File::readString() {
+    std::string text;
+    int c;
+    while ((c = read()) >= 0) text += (char)c;
+    return String(text);
+}
+
+std::string FS::hostPath(const char* path) const {
+    std::string full = root;
+    if (!path || path[0] != '/') full += '/';
+    if (path) full += path;
+    return full;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    if (root.empty() || !path) return File();
+    std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+    impl->devicePath = path;
+    const char* slash = strrchr(path, '/');
+    impl->baseName = slash ? slash + 1 : path;
+    impl->hostPath = hostPath(path);
+
+    struct stat info;
+    bool found = stat(impl->hostPath.c_str(), &info) == 0;
+    if (found && S_ISDIR(info.st_mode)) {
+        impl->directory = true;
+        DIR* dir = opendir(impl->hostPath.c_str());
+        if (!dir) return File();
+        while (struct dirent* entry = readdir(dir)) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) impl->entries.push_back(entry->d_name);
+        }
+        closedir(dir);
+        return File(impl);
+    }
+
+    bool reading = strcmp(mode, FILE_READ) == 0;
+    if (reading && !found) return File();
+    if (!reading && create) {
+        // Missing parent directories are created, as LittleFS does with create
+        for (size_t i = root.size() + 1; i < impl->hostPath.size(); i++) {
+            if (impl->hostPath[i] == '/') ::mkdir(impl->hostPath.substr(0, i).c_str(), 0755);
+        }
+    }
+    impl->file = fopen(impl->hostPath.c_str(), reading ? "rb" : (strcmp(mode, FILE_APPEND) == 0 ? "ab" : "wb"));
+    if (!impl->file) return File();
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    struct stat info;
+    return !root.empty() && stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return !root.empty() && unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    return !root.empty() && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return !root.empty() && (::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+bool FS::rmdir(const char* path) {
+    return !root.empty() && ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+} // namespace fs
+
+// Removes everything below `dir`
+static void removeTree(const std::string& dir) {
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) return;
+    while (struct dirent* entry = readdir(handle)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        std::string path = dir + "/" + entry->d_name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            removeTree(path);
+            rmdir(path.c_str());
+        } else {
+            unlink(path.c_str());
+        }
+    }
+    closedir(handle);
+}
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) {
+    std::string dir = HOST_LITTLEFS_DIR;
+    for (size_t i = 1; i <= dir.size(); i++) {
+        if (i == dir.size() || dir[i] == '/') ::mkdir(dir.substr(0, i).c_str(), 0755);
+    }
+    struct stat info;
+    if (stat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) return false;
+    root = dir;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    if (root.empty() && !begin()) return false;
+    removeTree(root);
+    return true;
+}
+
+void LittleFSFS::end() {
+    root.clear();
+}
+
+size_t LittleFSFS::totalBytes() {
+    return 0xE0000; // spiffs in partitions_bank.csv
+}
+
+size_t LittleFSFS::usedBytes() {
+    return 0;
+}
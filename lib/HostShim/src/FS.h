@@ -0,0 +1,79 @@
+#ifndef HOSTSHIM_FS_H
+#define HOSTSHIM_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+
+// A file or directory of a host-backed FS. Copies share the open file,
+// like the Arduino-ESP32 File.
+class File : public Print {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+    operator bool() const;
+    using Print::write;
+    size_t write(const uint8_t* data, size_t size) override;
+    int available();
+    int read();
+    size_t read(uint8_t* buffer, size_t size);
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+
+    const char* path() const;
+    const char* name() const; // Last path component, as in Arduino-ESP32 2.x
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+
+    String readStringUntil(char terminator);
+    String readString();
+
+private:
+    std::shared_ptr<FileImpl> impl;
+};
+
+// Maps the device paths of one mount to a host directory
+class FS {
+public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+protected:
+    std::string root; // Host directory, empty until mounted
+    std::string hostPath(const char* path) const;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
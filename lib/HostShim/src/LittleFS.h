@@ -0,0 +1,24 @@
+#ifndef HOSTSHIM_LITTLEFS_H
+#define HOSTSHIM_LITTLEFS_H
+
+#include <FS.h>
+
+// The host LittleFS lives in the directory HOST_LITTLEFS_DIR (relative to
+// the working directory, created on begin()). Tests start from an empty
+// one with format().
+#ifndef HOST_LITTLEFS_DIR
+#define HOST_LITTLEFS_DIR ".pio/littlefs"
+#endif
+
+class LittleFSFS : public fs::FS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+    bool format();
+    void end();
+    size_t totalBytes();
+    size_t usedBytes();
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
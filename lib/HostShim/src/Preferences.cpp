@@ -0,0 +1,66 @@
+#include "Preferences.h"
+#include <map>
+
+// namespace -> key -> value, as text
+static std::map<std::string, std::map<std::string, std::string>>& store() {
+    static std::map<std::string, std::map<std::string, std::string>> values;
+    return values;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+    if (!name || !name[0] || strlen(name) > 15) return false; // NVS key length limit
+    space = name;
+    this->readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end() {
+    space.clear();
+}
+
+bool Preferences::clear() {
+    if (space.empty() || readOnly) return false;
+    store()[space].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (space.empty() || readOnly) return false;
+    return store()[space].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    return !space.empty() && store()[space].count(key) > 0;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (space.empty() || readOnly || !key || strlen(key) > 15) return 0;
+    store()[space][key] = value ? value : "";
+    return strlen(value ? value : "") + 1;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) { return putString(key, String(value).c_str()) ? 1 : 0; }
+size_t Preferences::putBool(const char* key, bool value) { return putUChar(key, value ? 1 : 0); }
+size_t Preferences::putInt(const char* key, int32_t value) { return putString(key, String((long)value).c_str()) ? 4 : 0; }
+size_t Preferences::putUInt(const char* key, uint32_t value) { return putString(key, String((unsigned long)value).c_str()) ? 4 : 0; }
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    if (!isKey(key)) return defaultValue;
+    return String(store()[space][key]);
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+    return isKey(key) ? (uint8_t)getString(key).toInt() : defaultValue;
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+    return isKey(key) ? (int32_t)getString(key).toInt() : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    return isKey(key) ? (uint32_t)strtoul(getString(key).c_str(), nullptr, 10) : defaultValue;
+}
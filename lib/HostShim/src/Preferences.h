@@ -0,0 +1,34 @@
+#ifndef HOSTSHIM_PREFERENCES_H
+#define HOSTSHIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+// NVS stand-in: values are kept in memory for the life of the process,
+// per namespace, so they survive end() and begin() like on the device.
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = nullptr);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putUChar(const char* key, uint8_t value);
+    size_t putBool(const char* key, bool value);
+    size_t putInt(const char* key, int32_t value);
+    size_t putUInt(const char* key, uint32_t value);
+    size_t putString(const char* key, const char* value);
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+    bool getBool(const char* key, bool defaultValue = false);
+    int32_t getInt(const char* key, int32_t defaultValue = 0);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    String getString(const char* key, const String& defaultValue = String());
+
+private:
+    std::string space; // Empty: not begun
+    bool readOnly = false;
+};
+
+#endif
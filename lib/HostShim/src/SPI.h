@@ -0,0 +1,6 @@
+#ifndef HOSTSHIM_SPI_H
+#define HOSTSHIM_SPI_H
+
+// Nothing on the host uses SPI, the header only has to exist
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOSTSHIM_ESP_TIMER_H
+#define HOSTSHIM_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds since the program started (host monotonic clock)
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HOSTSHIM_FREERTOS_H
+#define HOSTSHIM_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Host stand-in for the FreeRTOS types and constants the firmware uses.
+// One tick is one millisecond, as on the CYD (CONFIG_FREERTOS_HZ=1000).
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskNO_AFFINITY 0x7fffffff
+#define configMAX_PRIORITIES 25
+
+#endif
@@ -0,0 +1,109 @@
+#include "task.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdlib.h>
+
+// One per task, never freed (tasks run until the program ends)
+struct HostTask {
+    HostTask(const char* name, uint32_t stackBytes, BaseType_t core) : name(name), stackBytes(stackBytes), core(core) {}
+
+    const char* name;
+    uint32_t stackBytes;
+    BaseType_t core;
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+};
+
+static thread_local HostTask* currentTask = nullptr;
+static HostTask mainTask("main", 8192, 1); // Runs setup() and loop() on the device
+
+// Set once main() returns: tasks then stop in their next wait instead of
+// running on while static objects (the SoundManager) are destroyed
+static std::atomic<bool> exiting{false};
+
+static void stopTasks() {
+    exiting = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Longer than any task runs between waits
+}
+
+static void parkIfExiting() {
+    if (!exiting || currentTask == &mainTask || !currentTask) return;
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+
+static HostTask* self() {
+    return currentTask ? currentTask : &mainTask;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackBytes, void* param,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t core) {
+    static std::once_flag registered;
+    std::call_once(registered, [] { atexit(stopTasks); });
+
+    HostTask* task = new HostTask(name, stackBytes, core);
+    if (handle) *handle = task;
+    std::thread([code, param, task] {
+        currentTask = task;
+        code(param);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackBytes, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(code, name, stackBytes, param, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t) {
+    // The thread ends when the task function returns; FreeRTOS tasks never do
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    parkIfExiting();
+    if (ticks == 0) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return self();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    parkIfExiting();
+    HostTask* task = self();
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto pending = [task] { return task->notifications > 0; };
+    if (ticks == portMAX_DELAY) task->notified.wait(guard, pending);
+    else task->notified.wait_for(guard, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), pending);
+
+    uint32_t count = task->notifications;
+    if (count > 0) task->notifications = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task ? task : self())->stackBytes;
+}
+
+BaseType_t xTaskGetAffinity(TaskHandle_t task) {
+    return (task ? task : self())->core;
+}
@@ -0,0 +1,25 @@
+#ifndef HOSTSHIM_TASK_H
+#define HOSTSHIM_TASK_H
+
+#include "FreeRTOS.h"
+
+// Tasks are host threads. Priorities and cores are recorded but not enforced:
+// the host scheduler runs every task whenever it is ready.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackBytes, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackBytes, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle);
+void vTaskDelete(TaskHandle_t task); // Only nullptr (the calling task) is supported
+
+// vTaskDelay(0) only yields
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task); // Host stacks are not measured: whole stack
+BaseType_t xTaskGetAffinity(TaskHandle_t task);
+
+#endif
@@ -0,0 +1,192 @@
+"""Builds the sample bank image for the 'bank' flash partition.
+
+Every <Set>_Downbeat.wav / <Set>_Beat.wav pair in data/ is converted to the
+device output format (mono, 44.1 kHz, 16-bit signed for I2S or 8-bit unsigned
+for the internal DAC) and packed with a small index (see src/SampleBank.h).
+
+    python scripts/build_bank.py            # I2S build
+    python scripts/build_bank.py --bits 8   # Internal DAC build
+
+Then flash it with the esptool command it prints.
+"""
+import argparse
+import math
+import os
+import struct
+
+from strip_metadata import data_dir, iter_chunks
+
+OUTPUT_RATE = 44100
+MIN_RATE = 8000
+NAME_LEN = 24
+VERSION = 2
+
+# Trimming and onset detection, as in SoundManager.h
+SILENCE_THRESHOLD = 64
+ONSET_PREROLL_FRAMES = 32
+ONSET_THRESHOLD_DIV = 8
+ONSET_MAX_LEAD = 256
+
+# Same filter as src/Resampler.cpp, so bank sounds match files loaded from LittleFS
+TAPS = 16
+PHASES = 32
+
+root_dir = os.path.join(os.path.dirname(__file__), '..')
+
+def read_wav(filepath):
+    with open(filepath, 'rb') as f:
+        data = f.read()
+    if data[:4] != b'RIFF' or data[8:12] != b'WAVE':
+        raise ValueError("Not a WAVE file")
+
+    fmt = None
+    pcm = None
+    for chunk_id, payload in iter_chunks(data):
+        if chunk_id == b'fmt ':
+            fmt = struct.unpack('<HHIIHH', payload[:16])
+        elif chunk_id == b'data':
+            pcm = payload
+            break
+    if fmt is None or pcm is None:
+        raise ValueError("Missing fmt or data chunk")
+
+    code, channels, rate, _, _, bits = fmt
+    if code != 1:
+        raise ValueError("Not PCM")
+    if bits not in (8, 16, 24) or channels not in (1, 2) or not MIN_RATE <= rate <= 48000:
+        raise ValueError(f"Unsupported format: {channels} ch, {rate} Hz, {bits} bit")
+
+    # Decode to 16-bit, downmix to mono (as the firmware does)
+    width = bits // 8
+    samples = []
+    for i in range(0, len(pcm) - width * channels + 1, width * channels):
+        val = 0
+        for c in range(channels):
+            p = i + c * width
+            if width == 1:
+                val += (pcm[p] - 128) << 8
+            else:
+                val += struct.unpack('<h', pcm[p+width-2:p+width])[0] # Drop LSB of 24-bit
+        samples.append(val >> (channels - 1))
+    return rate, samples
+
+def resample(samples, in_rate):
+    if in_rate == OUTPUT_RATE:
+        return samples
+
+    cutoff = (OUTPUT_RATE / in_rate if in_rate > OUTPUT_RATE else 1.0) * 0.92
+    coeffs = []
+    for p in range(PHASES):
+        center = TAPS // 2 - 1 + p / PHASES
+        taps = []
+        for k in range(TAPS):
+            d = k - center
+            x = math.pi * cutoff * d
+            sinc = 1.0 if abs(x) < 1e-6 else math.sin(x) / x
+            w = 0.42 + 0.5 * math.cos(2 * math.pi * d / TAPS) + 0.08 * math.cos(4 * math.pi * d / TAPS)
+            taps.append(sinc * w)
+        total = sum(taps)
+        coeffs.append([int(round(t / total * 16384)) for t in taps])
+
+    step = (in_rate << 16) // OUTPUT_RATE
+    phase = (TAPS // 2 - 1) << 16
+    history = [0] * TAPS
+    out = []
+    for s in samples + [0] * (TAPS // 2):
+        history = history[1:] + [s]
+        while phase < 65536:
+            acc = sum(h * c for h, c in zip(history, coeffs[phase >> 11]))
+            out.append(max(-32768, min(32767, (acc + 8192) >> 14)))
+            phase += step
+        phase -= 65536
+    return out
+
+def trim(samples):
+    """Drops leading and trailing silence. Returns (samples, onset)."""
+    audible = [i for i, s in enumerate(samples) if abs(s) >= SILENCE_THRESHOLD]
+    if not audible:
+        return [], 0
+    samples = samples[max(0, audible[0] - ONSET_PREROLL_FRAMES):audible[-1] + 1]
+
+    threshold = max(abs(s) for s in samples) // ONSET_THRESHOLD_DIV
+    head = samples[:ONSET_MAX_LEAD]
+    onset = next((i for i, s in enumerate(head) if abs(s) >= threshold), len(head))
+    return samples, onset
+
+def encode(samples, bits):
+    if bits == 16:
+        return struct.pack(f'<{len(samples)}h', *samples)
+    return bytes(((s >> 8) + 128) & 0xFF for s in samples)
+
+def align4(buf):
+    buf.extend(b'\0' * (-len(buf) % 4))
+
+def find_sets():
+    names = set()
+    for filename in os.listdir(data_dir):
+        if filename.endswith('_Downbeat.wav'):
+            name = filename[:-len('_Downbeat.wav')]
+            if os.path.exists(os.path.join(data_dir, name + '_Beat.wav')):
+                names.add(name)
+            else:
+                print(f"Skipping {name}: no _Beat.wav")
+    return sorted(names)
+
+def partition_info(csv_path, label):
+    with open(csv_path) as f:
+        for line in f:
+            fields = [x.strip() for x in line.split('#')[0].split(',')]
+            if fields[0] == label:
+                return int(fields[3], 0), int(fields[4], 0)
+    raise ValueError(f"No '{label}' partition in {csv_path}")
+
+def build(bits, out_path, csv_path):
+    offset, capacity = partition_info(csv_path, 'bank')
+
+    sets = []
+    for name in find_sets():
+        if len(name.encode()) >= NAME_LEN:
+            print(f"Skipping {name}: name longer than {NAME_LEN - 1} bytes")
+            continue
+        sounds = []
+        onsets = []
+        for suffix in ('_Downbeat.wav', '_Beat.wav'):
+            rate, samples = read_wav(os.path.join(data_dir, name + suffix))
+            samples, onset = trim(resample(samples, rate))
+            sounds.append(encode(samples, bits))
+            onsets.append(onset)
+        sets.append((name, sounds, onsets))
+
+    header_size = 20 + 48 * len(sets)
+    body = bytearray()
+    table = bytearray()
+    for name, sounds, onsets in sets:
+        offsets = []
+        for sound in sounds:
+            align4(body)
+            offsets.append(header_size + len(body))
+            body.extend(sound)
+        table += struct.pack(f'<{NAME_LEN}s6I', name.encode(), offsets[0], offsets[1],
+                             len(sounds[0]), len(sounds[1]), onsets[0], onsets[1])
+        print(f"  {name}: {len(sounds[0])} + {len(sounds[1])} bytes, onsets {onsets[0]} / {onsets[1]}")
+    align4(body)
+
+    total = header_size + len(body)
+    if total > capacity:
+        raise SystemExit(f"Bank is {total} bytes, partition holds {capacity}")
+
+    header = struct.pack('<4sHHIII', b'MBNK', VERSION, bits, OUTPUT_RATE, len(sets), total)
+    with open(out_path, 'wb') as f:
+        f.write(header + table + body)
+
+    print(f"Wrote {out_path}: {len(sets)} sets, {total} of {capacity} bytes")
+    print(f"Flash with: esptool.py write_flash 0x{offset:X} {out_path}")
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--bits', type=int, choices=(16, 8), default=16,
+                        help="16 for I2S (default), 8 for the internal DAC")
+    parser.add_argument('--out', default=os.path.join(root_dir, 'bank.bin'))
+    parser.add_argument('--partitions', default=os.path.join(root_dir, 'partitions_bank.csv'))
+    args = parser.parse_args()
+    build(args.bits, args.out, args.partitions)
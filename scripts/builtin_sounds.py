@@ -0,0 +1,69 @@
+"""Generates src/BuiltinSounds.cpp: the default set compiled into the firmware.
+
+The Metro sounds in data/ are converted exactly like sample bank sounds
+(mono, 44.1 kHz, trimmed, onset measured) and written out as const arrays in
+both output formats. The linker keeps only the one the build uses.
+
+Runs before every PlatformIO build (extra_scripts in platformio.ini) and only
+rewrites the file when a source WAV changed. Can also be run by hand:
+
+    python scripts/builtin_sounds.py
+"""
+import os
+import sys
+
+SET_NAME = 'Metro'
+COLUMNS = 16
+
+def generate(project_dir):
+    sys.path.insert(0, os.path.join(project_dir, 'scripts'))
+    from build_bank import data_dir, read_wav, resample, trim
+
+    out_path = os.path.join(project_dir, 'src', 'BuiltinSounds.cpp')
+    sources = [os.path.join(data_dir, SET_NAME + suffix) for suffix in ('_Downbeat.wav', '_Beat.wav')]
+    sources.append(os.path.join(project_dir, 'scripts', 'build_bank.py')) # Conversion changes too
+
+    if os.path.exists(out_path):
+        built = os.path.getmtime(out_path)
+        if all(os.path.getmtime(src) <= built for src in sources):
+            return
+
+    lines = [
+        f"// Generated by scripts/builtin_sounds.py from data/{SET_NAME}_*.wav. Do not edit.",
+        '#include "BuiltinSounds.h"',
+        '',
+    ]
+    frames = []
+    onsets = []
+    for role, path in zip(('Downbeat', 'Beat'), sources):
+        rate, samples = read_wav(path)
+        samples, onset = trim(resample(samples, rate))
+        frames.append(len(samples))
+        onsets.append(onset)
+
+        lines += array(f"const int16_t builtin{role}16[]", [str(s) for s in samples])
+        lines += array(f"const uint8_t builtin{role}8[]", [str(((s >> 8) + 128) & 0xFF) for s in samples])
+
+    lines.append(f"const uint32_t builtinFrames[2] = {{{frames[0]}, {frames[1]}}};")
+    lines.append(f"const uint32_t builtinOnset[2] = {{{onsets[0]}, {onsets[1]}}};")
+
+    with open(out_path, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    print(f"Wrote {out_path}: {frames[0]} + {frames[1]} frames, onsets {onsets[0]} / {onsets[1]}")
+
+def array(declaration, values):
+    lines = [declaration + ' = {']
+    for i in range(0, len(values), COLUMNS):
+        lines.append('    ' + ', '.join(values[i:i + COLUMNS]) + ',')
+    lines += ['};', '']
+    return lines
+
+try:
+    Import('env') # PlatformIO pre: script
+except NameError:
+    env = None
+
+if env is not None:
+    generate(env.subst('$PROJECT_DIR'))
+elif __name__ == '__main__':
+    generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
@@ -48,7 +48,19 @@ def strip_metadata(filepath):
     with open(filepath, 'wb') as f:
         f.write(new_data)
 
+def iter_chunks(data):
+    """Yields (chunk_id, payload) for every chunk after the RIFF/WAVE header."""
+    ptr = 12
+    while ptr + 8 <= len(data):
+        chunk_id = data[ptr:ptr+4]
+        chunk_size = struct.unpack('<I', data[ptr+4:ptr+8])[0]
+        yield chunk_id, data[ptr+8:ptr+8+chunk_size]
+        ptr += 8 + chunk_size
+        if chunk_size % 2 == 1: ptr += 1 # Padding
+
 data_dir = os.path.join(os.path.dirname(__file__), '../data')
-for filename in os.listdir(data_dir):
-    if filename.lower().endswith('.wav'):
-        strip_metadata(os.path.join(data_dir, filename))
+
+if __name__ == '__main__':
+    for filename in os.listdir(data_dir):
+        if filename.lower().endswith('.wav'):
+            strip_metadata(os.path.join(data_dir, filename))
@@ -0,0 +1,128 @@
+#include "Adpcm.h"
+
+static const int16_t stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t indexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Applies one nibble to the decoder state (shared by encoder and decoder,
+// so both always agree on the predictor)
+static inline void step(uint8_t nibble, Adpcm::State& state) {
+    int32_t stepSize = stepTable[state.index];
+    int32_t diff = stepSize >> 3;
+    if (nibble & 4) diff += stepSize;
+    if (nibble & 2) diff += stepSize >> 1;
+    if (nibble & 1) diff += stepSize >> 2;
+
+    int32_t predictor = state.predictor + ((nibble & 8) ? -diff : diff);
+    if (predictor > 32767) predictor = 32767;
+    else if (predictor < -32768) predictor = -32768;
+    state.predictor = (int16_t)predictor;
+
+    int32_t index = state.index + indexTable[nibble];
+    if (index < 0) index = 0;
+    else if (index > 88) index = 88;
+    state.index = (uint8_t)index;
+}
+
+// Encodes one sample against the state, returns the nibble
+static inline uint8_t encodeSample(int16_t sample, Adpcm::State& state) {
+    int32_t diff = sample - state.predictor;
+    int32_t stepSize = stepTable[state.index];
+    uint8_t nibble = 0;
+    if (diff < 0) { nibble = 8; diff = -diff; }
+    if (diff >= stepSize) { nibble |= 4; diff -= stepSize; }
+    stepSize >>= 1;
+    if (diff >= stepSize) { nibble |= 2; diff -= stepSize; }
+    stepSize >>= 1;
+    if (diff >= stepSize) nibble |= 1;
+    step(nibble, state);
+    return nibble;
+}
+
+void Adpcm::Encoder::begin(uint8_t* data) {
+    next = data;
+    count = 0;
+    index = 0;
+}
+
+void Adpcm::Encoder::push(int16_t sample) {
+    pending[count++] = sample;
+    if (count == ADPCM_BLOCK_SAMPLES) encodeBlock();
+}
+
+void Adpcm::Encoder::finish() {
+    if (count > 0) encodeBlock();
+}
+
+void Adpcm::Encoder::encodeBlock() {
+    // Pick the start index with the lowest error: the carried one or a coarse scan
+    uint8_t bestIndex = index;
+    uint64_t bestError = UINT64_MAX;
+    for (int candidate = -1; candidate <= 88; candidate += (candidate < 0 ? 1 : 8)) {
+        State state;
+        state.predictor = pending[0];
+        state.index = (candidate < 0) ? index : (uint8_t)candidate;
+        uint64_t error = 0;
+        for (size_t i = 0; i < count && error < bestError; i++) {
+            encodeSample(pending[i], state);
+            int32_t e = pending[i] - state.predictor;
+            error += (uint64_t)((int64_t)e * e);
+        }
+        if (error < bestError) {
+            bestError = error;
+            bestIndex = (candidate < 0) ? index : (uint8_t)candidate;
+        }
+    }
+
+    // Header: exact first sample, so errors never carry across blocks
+    State state;
+    state.predictor = pending[0];
+    state.index = bestIndex;
+    next[0] = (uint8_t)(pending[0] & 0xFF);
+    next[1] = (uint8_t)((pending[0] >> 8) & 0xFF);
+    next[2] = bestIndex;
+    next[3] = 0;
+
+    uint8_t* p = next + 4;
+    memset(p, 0, ADPCM_BLOCK_SAMPLES / 2);
+    for (size_t i = 0; i < count; i++) {
+        uint8_t nibble = encodeSample(pending[i], state);
+        p[i / 2] |= (i & 1) ? (nibble << 4) : nibble;
+    }
+
+    index = state.index;
+    next += ADPCM_BLOCK_BYTES;
+    count = 0;
+}
+
+void Adpcm::decode(const uint8_t* data, size_t pos, size_t n, int16_t* out, State& state) {
+    const uint8_t* block = data + pos / ADPCM_BLOCK_SAMPLES * ADPCM_BLOCK_BYTES;
+    size_t offset = pos % ADPCM_BLOCK_SAMPLES;
+
+    for (size_t i = 0; i < n; i++) {
+        if (offset == ADPCM_BLOCK_SAMPLES) {
+            block += ADPCM_BLOCK_BYTES;
+            offset = 0;
+        }
+        if (offset == 0) {
+            state.predictor = (int16_t)(block[0] | (block[1] << 8));
+            state.index = block[2] > 88 ? 88 : block[2];
+        }
+
+        uint8_t byte = block[4 + offset / 2];
+        step((offset & 1) ? (byte >> 4) : (byte & 0x0F), state);
+        out[i] = state.predictor;
+        offset++;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <Arduino.h>
+
+// IMA-ADPCM (4 bits per sample) for sounds kept in RAM.
+// Samples are stored in independent blocks: a 4-byte header with the decoder
+// state at the block start, then one nibble per sample (low nibble first).
+// Decoding walks forward from any position reached by decoding, and restarts
+// from the header at every block boundary, so a voice never needs more state
+// than Adpcm::State.
+#define ADPCM_BLOCK_SAMPLES 256
+#define ADPCM_BLOCK_BYTES (4 + ADPCM_BLOCK_SAMPLES / 2)
+
+namespace Adpcm {
+    struct State {
+        int16_t predictor = 0;
+        uint8_t index = 0; // Into the step size table
+    };
+
+    // Storage needed for the given number of samples (whole blocks)
+    inline size_t bytesFor(size_t samples) {
+        return (samples + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES * ADPCM_BLOCK_BYTES;
+    }
+
+    // Samples that fit into the given number of bytes
+    inline size_t samplesFor(size_t bytes) {
+        return bytes / ADPCM_BLOCK_BYTES * ADPCM_BLOCK_SAMPLES;
+    }
+
+    // Streams samples into consecutive blocks. Each block is encoded once it
+    // is complete, starting from whichever step size fits it best, so the sharp
+    // onset of a click is not smeared while the step size adapts.
+    class Encoder {
+    public:
+        void begin(uint8_t* data);
+        void push(int16_t sample);
+        void finish(); // Encodes the last, partial block
+
+    private:
+        uint8_t* next = nullptr;
+        int16_t pending[ADPCM_BLOCK_SAMPLES];
+        size_t count = 0;
+        uint8_t index = 0; // Carried over from the previous block
+
+        void encodeBlock();
+    };
+
+    // Decodes n samples starting at `pos`. `state` must be the one left by
+    // decoding up to pos (or anything, if pos starts a block).
+    void decode(const uint8_t* data, size_t pos, size_t n, int16_t* out, State& state);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "AllocDebug.h"
+
+#ifdef AUDIO_ALLOC_DEBUG
+
+static volatile uint32_t heapOps = 0;
+static volatile uint32_t watchedHeapOps = 0;
+static TaskHandle_t watchedTask = nullptr;
+
+static inline void countHeapOperation() {
+    heapOps++;
+    if (watchedTask && xTaskGetCurrentTaskHandle() == watchedTask) watchedHeapOps++;
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+    countHeapOperation();
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    countHeapOperation();
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    countHeapOperation();
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) countHeapOperation();
+    __real_free(ptr);
+}
+}
+
+void AllocDebug::watchTask(TaskHandle_t task) { watchedTask = task; }
+uint32_t AllocDebug::totalOperations() { return heapOps; }
+uint32_t AllocDebug::watchedTaskOperations() { return watchedHeapOps; }
+
+#endif
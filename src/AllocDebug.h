@@ -0,0 +1,18 @@
+#ifndef ALLOCDEBUG_H
+#define ALLOCDEBUG_H
+
+#include <Arduino.h>
+
+// Heap operation counters for the AUDIO_ALLOC_DEBUG build (env:cyd_alloc_debug).
+// malloc, calloc, realloc and free are wrapped by the linker, so every call
+// is counted and attributed to the watched (mixer) task if it made it.
+// heap_caps_* calls made directly by the IDF are not seen.
+#ifdef AUDIO_ALLOC_DEBUG
+namespace AllocDebug {
+    void watchTask(TaskHandle_t task);
+    uint32_t totalOperations();
+    uint32_t watchedTaskOperations();
+}
+#endif
+
+#endif
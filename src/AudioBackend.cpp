@@ -0,0 +1,151 @@
+#include "AudioBackend.h"
+#include "SoundManager.h"
+#include <driver/i2s.h>
+#include "SpscQueue.h"
+
+// --- Shared by I2S and built-in DAC ---
+
+static QueueHandle_t i2sEvents = nullptr;
+static volatile uint32_t i2sUnderruns = 0;
+
+// The driver reports TX_Q_OVF when the DMA finished a buffer while none
+// was refilled (it then replays silence, see tx_desc_auto_clear)
+static void countUnderruns() {
+    i2s_event_t event;
+    while (xQueueReceive(i2sEvents, &event, 0) == pdTRUE) {
+        if (event.type == I2S_EVENT_TX_Q_OVF) i2sUnderruns++;
+    }
+}
+
+// --- I2S ---
+
+void I2sBackend::begin() {
+    Serial.println("Initializing I2S...");
+
+    i2s_config_t i2s_config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
+        .sample_rate = AUDIO_SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT, // Mono
+        .communication_format = I2S_COMM_FORMAT_I2S, // Standard I2S
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = AUDIO_DMA_BUFFERS,
+        .dma_buf_len = AUDIO_DMA_FRAMES,
+        .use_apll = false,
+        .tx_desc_auto_clear = true // Auto clear to avoid noise
+    };
+
+    i2s_pin_config_t pin_config = {
+        .bck_io_num = I2S_BCLK,
+        .ws_io_num = I2S_LRCK,
+        .data_out_num = I2S_DOUT,
+        .data_in_num = I2S_PIN_NO_CHANGE
+    };
+
+    i2s_driver_install(I2S_NUM, &i2s_config, 8, &i2sEvents);
+    i2s_set_pin(I2S_NUM, &pin_config);
+    i2s_zero_dma_buffer(I2S_NUM);
+}
+
+void I2sBackend::write(const int16_t* block, size_t frames) {
+    size_t bytesWritten;
+    i2s_write(I2S_NUM, block, frames * sizeof(int16_t), &bytesWritten, portMAX_DELAY);
+    countUnderruns();
+}
+
+uint32_t I2sBackend::underruns() {
+    return i2sUnderruns;
+}
+
+// --- Built-in DAC ---
+
+static uint16_t dacBlock[AUDIO_BLOCK_FRAMES * 2]; // Both slots of each frame
+
+void DacBackend::begin() {
+    // Same block interface as external I2S: the mixer task fills DMA buffers
+    Serial.println("Initializing I2S (Built-in DAC)...");
+
+    i2s_config_t i2s_config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN),
+        .sample_rate = AUDIO_SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT, // DAC takes the high byte
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT, // Both slots written, see write()
+        .communication_format = I2S_COMM_FORMAT_STAND_MSB,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = AUDIO_DMA_BUFFERS,
+        .dma_buf_len = AUDIO_DMA_FRAMES,
+        .use_apll = false,
+        .tx_desc_auto_clear = true
+    };
+
+    i2s_driver_install(I2S_NUM, &i2s_config, 8, &i2sEvents);
+    i2s_set_pin(I2S_NUM, NULL); // Internal DAC routing
+    i2s_set_dac_mode(I2S_DAC_CHANNEL_LEFT_EN); // GPIO 26 only (GPIO 25 stays free)
+    i2s_zero_dma_buffer(I2S_NUM);
+}
+
+void DacBackend::write(const int16_t* block, size_t frames) {
+    // Unsigned, value in the high byte. The same sample goes to both slots
+    // so the DAC channel order of the I2S peripheral does not matter.
+    for (size_t i = 0; i < frames; i++) {
+        uint16_t val = (uint16_t)(block[i] + 32768) & 0xFF00;
+        dacBlock[i * 2] = val;
+        dacBlock[i * 2 + 1] = val;
+    }
+    size_t bytesWritten;
+    i2s_write(I2S_NUM, dacBlock, frames * 2 * sizeof(uint16_t), &bytesWritten, portMAX_DELAY);
+    countUnderruns();
+}
+
+uint32_t DacBackend::underruns() {
+    return i2sUnderruns;
+}
+
+// --- Built-in DAC, timer ISR ---
+
+static hw_timer_t* dacTimer = nullptr;
+static SpscQueue<uint8_t, 1024> dacFifo; // Rendered samples waiting for the ISR
+static TaskHandle_t dacWriter = nullptr; // Woken once half the FIFO has drained
+static volatile uint32_t dacUnderruns = 0;
+
+// One sample per interrupt
+static void IRAM_ATTR onDacTimer() {
+    static bool dry = true;
+    uint8_t output;
+    if (dacFifo.pop(output)) {
+        dacWrite(26, output);
+        dry = false;
+    } else if (!dry && dacWriter) {
+        dacUnderruns++;
+        dry = true;
+    }
+
+    if (dacWriter && dacFifo.size() == dacFifo.capacity() / 2) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(dacWriter, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+void DacTimerBackend::begin() {
+    Serial.println("Initializing DAC (timer ISR)...");
+    dacWrite(26, 128); // Center (silence) to avoid a pop
+
+    // Timer 0, divider 2 (40 MHz) so the sample period is close to 44.1 kHz
+    dacTimer = timerBegin(0, 2, true);
+    timerAttachInterrupt(dacTimer, &onDacTimer, true);
+    timerAlarmWrite(dacTimer, 40000000 / AUDIO_SAMPLE_RATE, true);
+    timerAlarmEnable(dacTimer);
+}
+
+void DacTimerBackend::write(const int16_t* block, size_t frames) {
+    if (!dacWriter) dacWriter = xTaskGetCurrentTaskHandle();
+    for (size_t i = 0; i < frames; i++) {
+        uint8_t val = fromPcm16(block[i]);
+        while (!dacFifo.push(val)) ulTaskNotifyTake(pdTRUE, 1);
+    }
+}
+
+uint32_t DacTimerBackend::underruns() {
+    return dacUnderruns;
+}
@@ -0,0 +1,70 @@
+#ifndef AUDIOBACKEND_H
+#define AUDIOBACKEND_H
+
+#include <Arduino.h>
+
+// Output backends. Exactly one is picked at compile time (OutputBackend in
+// SoundManager.h). It fixes the sample format kept in RAM and how mixer
+// blocks reach the hardware, so no per-sample loop branches on the output.
+// Every backend takes blocks of 16-bit signed mono samples.
+// The DMA queue behind write() is what keeps playing while flash is written
+// (see AUDIO_DMA_BUFFERS).
+
+// External I2S amp (MAX98357A): 16-bit signed in RAM
+struct I2sBackend {
+    typedef int16_t Sample;
+
+    static void begin();
+    static void write(const int16_t* block, size_t frames); // Blocks while the DMA is full
+    static uint32_t underruns(); // Times the DMA ran out of queued audio since begin()
+
+    static inline Sample fromPcm16(int16_t val) { return val; }
+    static inline int32_t toPcm16(Sample s) { return s; }
+};
+
+// Internal DAC (GPIO 26) via I2S0 built-in DAC DMA: 8-bit unsigned in RAM
+struct DacBackend {
+    typedef uint8_t Sample;
+
+    static void begin();
+    static void write(const int16_t* block, size_t frames); // Blocks while the DMA is full
+    static uint32_t underruns();
+
+    static inline Sample fromPcm16(int16_t val) { return (uint8_t)((val >> 8) + 128); }
+    static inline int32_t toPcm16(Sample s) { return ((int32_t)s - 128) << 8; }
+};
+
+// Internal DAC (GPIO 26) from a 44.1 kHz timer ISR, one dacWrite per
+// sample: the path DacBackend replaced, kept so the two can be compared
+// (test/embedded/test_dac_load). The FIFO holds 23 ms, far less than a flash
+// erase, so saving while playing glitches.
+struct DacTimerBackend {
+    typedef uint8_t Sample;
+
+    static void begin();
+    static void write(const int16_t* block, size_t frames); // Blocks while the FIFO is full
+    static uint32_t underruns(); // Times the FIFO ran dry since the first write
+
+    static inline Sample fromPcm16(int16_t val) { return (uint8_t)((val >> 8) + 128); }
+    static inline int32_t toPcm16(Sample s) { return ((int32_t)s - 128) << 8; }
+};
+
+// No output device: blocks are paced in real time and handed to `capture`
+// (if set). Runs the whole audio path without hardware, on the device or on
+// the host (env:native, see test/). Tests clear `paced` to render as fast as
+// the mixer can; the beat clock counts samples, so timing stays the same.
+struct NullBackend {
+    typedef int16_t Sample;
+
+    static void (*capture)(const int16_t* block, size_t frames);
+    static bool paced;
+
+    static void begin();
+    static void write(const int16_t* block, size_t frames);
+    static uint32_t underruns() { return 0; }
+
+    static inline Sample fromPcm16(int16_t val) { return val; }
+    static inline int32_t toPcm16(Sample s) { return s; }
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef BEATSCHEDULER_H
+#define BEATSCHEDULER_H
+
+#include <Arduino.h>
+#include "Timeline.h"
+
+// Output sample rate of the audio path. All beat positions are counted in
+// samples at this rate.
+#define AUDIO_SAMPLE_RATE 44100
+
+// Sample-accurate beat clock.
+// The beat interval (AUDIO_SAMPLE_RATE * 60 / bpm) is kept as an exact fraction:
+// a whole number of samples plus a remainder that is accumulated Bresenham-style.
+// Beat k therefore always lands on sample floor(k * rate * 60 / bpm) and no
+// rounding error builds up, no matter how long the metronome runs.
+// The clock is advanced by whoever renders the output stream, so it is tied to
+// the samples actually sent to the DAC / I2S and not to millis().
+//
+// It either runs free (one tempo, changed by setTempo) or plays a compiled
+// Timeline, taking tempo (or tempo ramp), bar length and accents from each
+// bar in turn.
+class BeatScheduler {
+public:
+    void start(uint64_t now, int bpm, int beatsPerBar) {
+        paused = false;
+        timeline = nullptr;
+        ramp = nullptr;
+        pendingTimeline = nullptr;
+        accentMask = 1;
+        setTempo(bpm, beatsPerBar);
+        nextOnsetPos = now;
+        lastOnsetPos = now;
+        fraction = 0;
+        beatIndex = 0;
+        running = true;
+    }
+
+    // Plays `program` from its first bar, the downbeat on sample `now`.
+    // The timeline must stay valid until the scheduler is started again or
+    // has moved on to a replacement (see timelinePlaying()).
+    void start(uint64_t now, const Timeline* program, bool loop) {
+        paused = false;
+        timeline = program;
+        pendingTimeline = nullptr;
+        pendingJump = NO_JUMP;
+        looping = loop;
+        running = true;
+        enterBar(0, now);
+        lastOnsetPos = now;
+    }
+
+    // Swaps in an edited program from the next bar on, continuing at the same
+    // bar number. Ignored unless a program is playing.
+    void replaceTimeline(const Timeline* program) {
+        if (timeline) pendingTimeline = program;
+    }
+
+    // Program playback: whether to start over after the last bar or stop
+    void setLoop(bool loop) { looping = loop; }
+
+    // Moves to bar `index` of the program at the next downbeat, or right away
+    // while paused (resume() then starts on that downbeat).
+    void jumpTo(uint32_t index) {
+        if (!timeline) return;
+        if (paused) {
+            if (index >= timeline->size()) return;
+            enterBar(index, pausedAt);
+            lastOnsetPos = pausedAt;
+        } else {
+            pendingJump = index; // Checked against the program playing by then
+        }
+    }
+
+    void stop() {
+        running = false;
+        paused = false;
+    }
+
+    // Holds the clock at `now`. resume() continues with the same distance to
+    // the next beat, so the beat phase is kept exactly.
+    void pause(uint64_t now) {
+        if (!running) return;
+        running = false;
+        paused = true;
+        pausedAt = now;
+    }
+
+    void resume(uint64_t now) {
+        if (!paused) return;
+        uint64_t shift = now - pausedAt;
+        nextOnsetPos += shift;
+        lastOnsetPos += shift;
+        origin += shift;
+        paused = false;
+        running = true;
+    }
+
+    bool isRunning() const { return running; }
+    bool isPaused() const { return paused; }
+
+    // The program being played (nullptr when running free)
+    const Timeline* timelinePlaying() const { return timeline; }
+
+    // Sample position the program's current pass started on, so
+    // timelinePlaying()->barAt(position - programStart()) finds any bar
+    uint64_t programStart() const { return origin; }
+
+    // Bar of the next beat (nullptr when running free)
+    const TimelineBar* currentBar() const { return timeline ? &timeline->bar(barIndex) : nullptr; }
+
+    // Changes tempo and time signature. The interval leading into the next
+    // beat is re-timed from the last onset, so a change made right after a
+    // beat already applies to that beat.
+    // Running free only: a program sets its own tempo.
+    void setTempo(int bpm, int beatsPerBar) {
+        if (timeline) return;
+        if (bpm < 1) bpm = 1;
+        if (beatsPerBar < 1) beatsPerBar = 1;
+
+        const uint32_t samplesPerMinute = (uint32_t)AUDIO_SAMPLE_RATE * 60;
+        tempo = (uint32_t)bpm;
+        stepWhole = samplesPerMinute / tempo;
+        stepRemainder = samplesPerMinute % tempo;
+        barLength = (uint8_t)beatsPerBar;
+        if (beatIndex >= barLength) beatIndex = 0;
+
+        if (running && nextOnsetPos != lastOnsetPos) {
+            fraction = stepRemainder;
+            nextOnsetPos = lastOnsetPos + stepWhole;
+            if (fraction >= tempo) {
+                fraction -= tempo;
+                nextOnsetPos++;
+            }
+        }
+    }
+
+    // Makes the next scheduled beat a downbeat (running free only).
+    void restartBar() {
+        if (!timeline) beatIndex = 0;
+    }
+
+    // Absolute sample position of the next beat.
+    uint64_t nextOnset() const { return nextOnsetPos; }
+
+    // Position of the next beat inside its bar (0 = downbeat).
+    uint8_t beatInBar() const { return beatIndex; }
+
+    // Whether the next beat plays the downbeat sound.
+    bool accented() const { return beatIndex < 16 && ((accentMask >> beatIndex) & 1); }
+
+    // Consumes the pending beat and schedules the one after it.
+    void advance() {
+        lastOnsetPos = nextOnsetPos;
+        if (ramp) {
+            ramp->advance(timeline->samplesPerMinute(), rampTempo, period, nextOnsetPos, rampFraction);
+        } else {
+            nextOnsetPos += stepWhole;
+            fraction += stepRemainder;
+            if (fraction >= tempo) {
+                fraction -= tempo;
+                nextOnsetPos++;
+            }
+        }
+        beatIndex++;
+        if (beatIndex >= barLength) {
+            beatIndex = 0;
+            if (timeline) nextBar();
+        }
+    }
+
+private:
+    bool running = false;
+    bool paused = false;
+    uint64_t pausedAt = 0;
+    uint64_t nextOnsetPos = 0;
+    uint64_t lastOnsetPos = 0;
+
+    const Timeline* timeline = nullptr;
+    const Timeline* pendingTimeline = nullptr;
+    bool looping = false;
+    uint32_t barIndex = 0;
+    static const uint32_t NO_JUMP = UINT32_MAX;
+    uint32_t pendingJump = NO_JUMP; // Bar to continue with at the next downbeat
+    uint64_t origin = 0;     // Sample position of the program start (this pass)
+
+    // Tempo ramp of the current bar (nullptr: steady)
+    const TimelineRamp* ramp = nullptr;
+    uint32_t rampTempo = 0;    // Q16 bpm of the next beat
+    uint32_t period = 0;       // Q32 minutes per beat of the next beat
+    uint32_t rampFraction = 0; // Of a sample, / 2^32
+    uint16_t accentMask = 1; // Bit n: beat n is accented
+
+    uint32_t tempo = 120;          // Denominator of the fractional step
+    uint32_t stepWhole = AUDIO_SAMPLE_RATE / 2;
+    uint32_t stepRemainder = 0;
+    uint32_t fraction = 0;         // Accumulated remainder, always < tempo
+
+    uint8_t barLength = 4;
+    uint8_t beatIndex = 0;
+
+    // The clock has just reached the end of the bar, nextOnsetPos is the
+    // downbeat of the next one. O(1): the next bar is the next array entry.
+    void nextBar() {
+        if (pendingTimeline) {
+            timeline = pendingTimeline;
+            pendingTimeline = nullptr;
+        }
+        uint32_t next = barIndex + 1;
+        if (pendingJump != NO_JUMP) {
+            if (pendingJump < timeline->size()) next = pendingJump;
+            pendingJump = NO_JUMP;
+        }
+        if (next >= timeline->size()) {
+            if (!looping) {
+                running = false;
+                return;
+            }
+            next = 0;
+        }
+        enterBar(next, nextOnsetPos);
+    }
+
+    void enterBar(uint32_t index, uint64_t downbeat) {
+        const TimelineBar& bar = timeline->bar(index);
+        barIndex = index;
+        if (bar.tempo == 0) {
+            ramp = &timeline->ramp(bar.step);
+            rampTempo = bar.rampTempo;
+            period = bar.period;
+            rampFraction = bar.startFraction;
+        } else {
+            ramp = nullptr;
+            tempo = bar.tempo;
+            stepWhole = bar.stepWhole;
+            stepRemainder = bar.stepRemainder;
+            fraction = bar.startFraction;
+        }
+        barLength = bar.beats;
+        accentMask = bar.accents;
+        beatIndex = 0;
+        nextOnsetPos = downbeat;
+        origin = downbeat - bar.start;
+    }
+};
+
+#endif
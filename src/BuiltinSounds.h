@@ -0,0 +1,22 @@
+#ifndef BUILTINSOUNDS_H
+#define BUILTINSOUNDS_H
+
+#include <Arduino.h>
+
+// Default sound set compiled into the firmware (BuiltinSounds.cpp is
+// generated by scripts/builtin_sounds.py before each build).
+// Converted like sample bank sounds: mono at AUDIO_SAMPLE_RATE, trimmed,
+// in both output formats. Being const, the arrays stay in flash and are
+// played in place, so the metronome works even without a filesystem image.
+
+#define BUILTIN_SET_NAME "Metro"
+
+extern const int16_t builtinDownbeat16[]; // I2S (16-bit signed)
+extern const int16_t builtinBeat16[];
+extern const uint8_t builtinDownbeat8[];  // Internal DAC (8-bit unsigned)
+extern const uint8_t builtinBeat8[];
+
+extern const uint32_t builtinFrames[2]; // Indexed by SoundType
+extern const uint32_t builtinOnset[2];  // Start to perceived onset, in samples
+
+#endif
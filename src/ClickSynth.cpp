@@ -0,0 +1,133 @@
+#include "ClickSynth.h"
+#include "BeatScheduler.h"
+
+static const SynthPreset presets[] = {
+    // name         wave           lvl  freq  freq2 sweep ms noise tone decay
+    {"Beep",        WAVE_SINE,     200, 1000,    0,  0,   0,   0,   0,  30},
+    {"Woodblock",   WAVE_SINE,     255,  850,    0,  6,   3,  40, 128,  18},
+    {"Cowbell",     WAVE_SQUARE,   150,  540,  800,  0,   0,   0,   0,  60},
+    {"Rim",         WAVE_TRIANGLE, 255, 1700,    0,  4,   1, 110,   0,   8},
+    {"Tick",        WAVE_SINE,     255, 3000,    0,  0,   0, 200,  64,   3},
+};
+
+static const size_t presetCount = sizeof(presets) / sizeof(presets[0]);
+
+// Accented variant (downbeats): a fifth up, 5/4 the decay and level
+static inline uint32_t accentFreq(uint32_t freq, bool accent) { return accent ? freq * 3 / 2 : freq; }
+static inline uint32_t accentDecay(uint32_t ms, bool accent) { return accent ? ms * 5 / 4 : ms; }
+static inline uint32_t accentLevel(uint32_t level, bool accent) {
+    if (!accent) return level;
+    level = level * 5 / 4;
+    return level > 255 ? 255 : level;
+}
+
+static inline int32_t mulQ31(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> 31);
+}
+
+// Q31 factor that decays by 1/e over `ms`: 1 - 1/tau, within 1% of
+// exp(-1/tau) for tau >= 1 ms. Integer only, it runs on the mixer task.
+static inline int32_t decayFactor(uint32_t ms) {
+    if (ms == 0) return 0;
+    uint32_t tau = ms * AUDIO_SAMPLE_RATE / 1000;
+    return INT32_MAX - (int32_t)(0x80000000u / tau);
+}
+
+static const uint32_t phasePerHz = (uint32_t)(4294967296.0 / AUDIO_SAMPLE_RATE + 0.5);
+
+static inline uint32_t phaseStep(uint32_t freq) {
+    return freq * phasePerHz;
+}
+
+template <int Wave>
+static inline int32_t oscillator(uint32_t phase) {
+    int32_t x = (int32_t)phase >> 16; // -1 .. 1 (Q15) over one cycle
+    if (Wave == WAVE_SQUARE) return x >= 0 ? 23170 : -23170; // -3 dB, same loudness as the sine
+    int32_t ax = x < 0 ? -x : x;
+    if (Wave == WAVE_TRIANGLE) {
+        int32_t t = 32767 - 2 * ax;
+        return t < -32767 ? -32767 : t;
+    }
+    return (x * (32767 - ax)) >> 13; // 4x(1 - |x|), within 0.06 of a sine
+}
+
+template <int Wave>
+static void renderWave(ClickSynth::State& s, int16_t* out, size_t n) {
+    // Locals, so the loop runs in registers
+    uint32_t phase = s.phase, phase2 = s.phase2;
+    int32_t sweep = s.sweep, env = s.env, lp = s.noiseLp;
+    uint32_t seed = s.noiseSeed;
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t osc = oscillator<Wave>(phase);
+        phase += s.step + (uint32_t)sweep;
+        sweep = mulQ31(sweep, s.sweepDecay);
+        if (s.step2) {
+            osc = (osc + oscillator<Wave>(phase2)) >> 1;
+            phase2 += s.step2;
+        }
+
+        // xorshift32, smoothed by a one-pole lowpass
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        int32_t white = (int32_t)seed >> 16;
+        lp += ((white - lp) * s.noiseCoef) >> 8;
+
+        int32_t mix = (osc * (256 - s.noiseMix) + lp * s.noiseMix) >> 8;
+        int32_t v = (mix * (env >> 16)) >> 15;
+        out[i] = (int16_t)((v * s.level) >> 8);
+        env = mulQ31(env, s.envDecay);
+    }
+
+    s.phase = phase;
+    s.phase2 = phase2;
+    s.sweep = sweep;
+    s.env = env;
+    s.noiseLp = lp;
+    s.noiseSeed = seed;
+}
+
+size_t ClickSynth::count() {
+    return presetCount;
+}
+
+const SynthPreset& ClickSynth::preset(size_t i) {
+    return presets[i];
+}
+
+int ClickSynth::find(const String& name) {
+    for (size_t i = 0; i < presetCount; i++) {
+        if (name == presets[i].name) return (int)i;
+    }
+    return -1;
+}
+
+size_t ClickSynth::frames(const SynthPreset& preset, bool accent) {
+    return (size_t)accentDecay(preset.decayMs, accent) * 6 * AUDIO_SAMPLE_RATE / 1000;
+}
+
+void ClickSynth::start(const SynthPreset& preset, bool accent, State& state) {
+    state.phase = 0;
+    state.phase2 = 0;
+    state.step = phaseStep(accentFreq(preset.freq, accent));
+    state.step2 = preset.freq2 ? phaseStep(accentFreq(preset.freq2, accent)) : 0;
+    state.sweep = (int32_t)((state.step >> 4) * preset.sweep);
+    state.sweepDecay = decayFactor(preset.sweepMs);
+    state.env = INT32_MAX;
+    state.envDecay = decayFactor(accentDecay(preset.decayMs, accent));
+    state.noiseSeed = 0x9E3779B9u; // Same noise every time, so every click sounds alike
+    state.noiseLp = 0;
+    state.noiseCoef = 256 - preset.noiseTone;
+    state.noiseMix = preset.noise;
+    state.level = accentLevel(preset.level, accent);
+    state.wave = preset.wave;
+}
+
+void ClickSynth::render(State& state, int16_t* out, size_t n) {
+    switch (state.wave) {
+        case WAVE_TRIANGLE: renderWave<WAVE_TRIANGLE>(state, out, n); break;
+        case WAVE_SQUARE:   renderWave<WAVE_SQUARE>(state, out, n); break;
+        default:            renderWave<WAVE_SINE>(state, out, n); break;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef CLICKSYNTH_H
+#define CLICKSYNTH_H
+
+#include <Arduino.h>
+
+// Procedural click sounds, rendered while mixing: they take no sample memory.
+// A voice is one or two fixed-point oscillators with an optional pitch drop,
+// plus filtered noise, under an exponentially decaying envelope. A preset is
+// only these parameters (kept in flash). The accented variant used for
+// downbeats is derived from them: a fifth higher, a bit longer and louder.
+
+enum SynthWave {
+    WAVE_SINE,     // Parabolic approximation
+    WAVE_TRIANGLE,
+    WAVE_SQUARE
+};
+
+struct SynthPreset {
+    char name[12];      // As listed next to the WAV sets
+    uint8_t wave;       // SynthWave, both oscillators
+    uint8_t level;      // Peak level, 0-255
+    uint16_t freq;      // Hz
+    uint16_t freq2;     // Second oscillator in Hz, 0 = off
+    uint8_t sweep;      // Start pitch above freq in 1/16 (up to 16 = octave), 0 = none
+    uint8_t sweepMs;    // Time constant of the pitch drop
+    uint8_t noise;      // Noise in the mix, 0-255
+    uint8_t noiseTone;  // One-pole lowpass on the noise, 0 = bright .. 255 = dark
+    uint16_t decayMs;   // Time constant of the amplitude decay
+};
+
+namespace ClickSynth {
+    struct State {
+        uint32_t phase = 0;
+        uint32_t phase2 = 0;
+        uint32_t step = 0;        // Phase increments (2^32 = one cycle)
+        uint32_t step2 = 0;
+        int32_t sweep = 0;        // Extra increment of the pitch drop, decays
+        int32_t sweepDecay = 0;   // Q31 factors per sample
+        int32_t env = 0;          // Q31
+        int32_t envDecay = 0;
+        uint32_t noiseSeed = 1;
+        int32_t noiseLp = 0;
+        int32_t noiseCoef = 256;  // Q8
+        int32_t noiseMix = 0;     // Q8
+        int32_t level = 0;        // Q8
+        uint8_t wave = WAVE_SINE;
+    };
+
+    size_t count();
+    const SynthPreset& preset(size_t i);
+    int find(const String& name); // -1 if there is no such preset
+
+    // Length until the envelope is down ~52 dB
+    size_t frames(const SynthPreset& preset, bool accent);
+
+    void start(const SynthPreset& preset, bool accent, State& state);
+    void render(State& state, int16_t* out, size_t n);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "GainStage.h"
+
+// round(32768 * 10^(-GAIN_RANGE_DB * (255 - level) / 255 / 20)), level 0 = mute.
+static const uint16_t levelGain[256] = {
+    0, 334, 340, 346, 352, 359, 365, 372, 379, 386, 393, 400, 407, 414, 422, 430,
+    437, 445, 454, 462, 470, 479, 488, 496, 505, 515, 524, 534, 543, 553, 563, 574,
+    584, 595, 606, 617, 628, 639, 651, 663, 675, 687, 700, 712, 725, 739, 752, 766,
+    780, 794, 808, 823, 838, 853, 869, 885, 901, 917, 934, 951, 968, 986, 1004, 1022,
+    1041, 1060, 1079, 1099, 1119, 1139, 1160, 1181, 1203, 1225, 1247, 1270, 1293, 1316, 1340, 1365,
+    1390, 1415, 1441, 1467, 1494, 1521, 1549, 1577, 1606, 1635, 1665, 1695, 1726, 1757, 1789, 1822,
+    1855, 1889, 1923, 1958, 1994, 2031, 2068, 2105, 2144, 2183, 2222, 2263, 2304, 2346, 2389, 2432,
+    2477, 2522, 2568, 2615, 2662, 2711, 2760, 2810, 2862, 2914, 2967, 3021, 3076, 3132, 3189, 3247,
+    3307, 3367, 3428, 3491, 3554, 3619, 3685, 3752, 3820, 3890, 3961, 4033, 4107, 4182, 4258, 4335,
+    4414, 4495, 4577, 4660, 4745, 4831, 4919, 5009, 5100, 5193, 5288, 5384, 5483, 5582, 5684, 5788,
+    5893, 6001, 6110, 6221, 6335, 6450, 6568, 6687, 6809, 6933, 7060, 7188, 7319, 7453, 7588, 7727,
+    7868, 8011, 8157, 8306, 8457, 8611, 8768, 8928, 9090, 9256, 9425, 9597, 9771, 9950, 10131, 10315,
+    10503, 10695, 10890, 11088, 11290, 11496, 11706, 11919, 12136, 12357, 12582, 12812, 13045, 13283, 13525, 13771,
+    14022, 14278, 14538, 14803, 15073, 15348, 15627, 15912, 16202, 16497, 16798, 17104, 17416, 17733, 18056, 18385,
+    18720, 19061, 19409, 19763, 20123, 20489, 20863, 21243, 21630, 22024, 22426, 22834, 23250, 23674, 24106, 24545,
+    24992, 25448, 25911, 26383, 26864, 27354, 27852, 28360, 28877, 29403, 29939, 30484, 31040, 31606, 32182, 32768,
+};
+
+uint16_t Gain::fromLevel(uint8_t level) {
+    return levelGain[level];
+}
+
+static inline int32_t scale(int32_t acc, int32_t gain) {
+    // 64-bit product: five full-scale voices times unity overflow 32 bits
+    int32_t v = (int32_t)(((int64_t)acc * gain) >> 15);
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return v;
+}
+
+static inline uint32_t pack(int32_t first, int32_t second) {
+    return (uint16_t)first | ((uint32_t)(uint16_t)second << 16); // Little endian
+}
+
+void Gain::Ramp::apply(const int32_t* in, int16_t* out, size_t frames) {
+    uint32_t* out32 = (uint32_t*)out;
+    int32_t end = (int32_t)target << 8;
+
+    if (current == end) {
+        int32_t g = end >> 8;
+        for (size_t i = 0; i < frames; i += 2) {
+            out32[i >> 1] = pack(scale(in[i], g), scale(in[i + 1], g));
+        }
+        return;
+    }
+
+    int32_t g = current;
+    int32_t step = (end - g) / (int32_t)frames;
+    for (size_t i = 0; i < frames; i += 2) {
+        g += step;
+        int32_t first = scale(in[i], g >> 8);
+        g += step;
+        out32[i >> 1] = pack(first, scale(in[i + 1], g >> 8));
+    }
+    current = end; // Rounding of step left it just short
+}
@@ -0,0 +1,30 @@
+#ifndef GAINSTAGE_H
+#define GAINSTAGE_H
+
+#include <Arduino.h>
+
+// Levels (0-255, as used by the UI) map to gains in equal dB steps over
+// GAIN_RANGE_DB, so each step sounds equally loud. 0 mutes, 255 is unity.
+#define GAIN_RANGE_DB 40
+#define GAIN_UNITY 32768 // Q15
+
+namespace Gain {
+    uint16_t fromLevel(uint8_t level); // Q15
+
+    // Output gain of the mixer. A new target is reached by a linear ramp
+    // across one block, so volume changes do not step (zipper noise).
+    class Ramp {
+    public:
+        void setTarget(uint16_t gain) { target = gain; }
+
+        // Scales and saturates the summed voices to 16-bit. Two samples are
+        // stored per 32-bit write: frames must be even and out 4-byte aligned.
+        void apply(const int32_t* in, int16_t* out, size_t frames);
+
+    private:
+        int32_t current = 0;  // Q23, so short ramps still move every sample
+        uint16_t target = 0;  // Q15
+    };
+}
+
+#endif
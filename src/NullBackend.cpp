@@ -0,0 +1,32 @@
+#include "AudioBackend.h"
+#include "SoundManager.h"
+#include <esp_timer.h>
+
+// Kept apart from the I2S backends so the native build needs no driver headers
+
+void (*NullBackend::capture)(const int16_t* block, size_t frames) = nullptr;
+bool NullBackend::paced = true;
+
+static int64_t nullStartUs = 0;
+static uint64_t nullFrames = 0;
+
+void NullBackend::begin() {
+    Serial.println("Audio output disabled (Null backend)");
+    nullStartUs = esp_timer_get_time();
+    nullFrames = 0;
+}
+
+void NullBackend::write(const int16_t* block, size_t frames) {
+    if (capture) capture(block, frames);
+
+    nullFrames += frames;
+    if (!paced) {
+        vTaskDelay(0); // Lets the other tasks in
+        return;
+    }
+
+    // Keep real-time pace so the beat clock behaves as it does on hardware
+    int64_t due = nullStartUs + (int64_t)(nullFrames * 1000000 / AUDIO_SAMPLE_RATE);
+    int64_t ahead = due - esp_timer_get_time();
+    if (ahead >= 1000 * portTICK_PERIOD_MS) vTaskDelay(ahead / 1000 / portTICK_PERIOD_MS);
+}
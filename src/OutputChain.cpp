@@ -0,0 +1,154 @@
+#include "OutputChain.h"
+#include "BeatScheduler.h"
+#include <math.h>
+
+enum EqType {
+    EQ_HIGHPASS,
+    EQ_PEAK,
+    EQ_HIGHSHELF
+};
+
+struct EqSection {
+    EqType type;
+    float freq; // Hz
+    float q;
+    float gainDb; // EQ_PEAK, EQ_HIGHSHELF
+};
+
+// Small full-range speakers (20-40 mm, as used with the MAX98357A): almost
+// no output below ~200 Hz, most efficient around 2-4 kHz.
+static const EqSection speakerEq[OUTPUT_EQ_SECTIONS] = {
+    {EQ_HIGHPASS,  180.0f, 0.707f, 0.0f},
+    {EQ_PEAK,     2800.0f, 1.0f,   4.0f},
+    {EQ_HIGHSHELF, 9000.0f, 0.707f, -3.0f}, // Tame the harsh top of small cones
+};
+
+static inline int32_t toQ28(float v) {
+    return (int32_t)lroundf(v * (float)(1 << 28));
+}
+
+static inline int32_t mulQ30(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+OutputChain::OutputChain() {
+    // RBJ audio EQ cookbook designs
+    float makeup = powf(10.0f, OUTPUT_MAKEUP_DB / 20.0f);
+    for (int i = 0; i < OUTPUT_EQ_SECTIONS; i++) {
+        const EqSection& s = speakerEq[i];
+        float w0 = 2.0f * (float)M_PI * s.freq / AUDIO_SAMPLE_RATE;
+        float cw = cosf(w0);
+        float alpha = sinf(w0) / (2.0f * s.q);
+        float A = powf(10.0f, s.gainDb / 40.0f);
+        float b0, b1, b2, a0, a1, a2;
+
+        switch (s.type) {
+            case EQ_HIGHPASS:
+                b0 = (1 + cw) / 2; b1 = -(1 + cw); b2 = (1 + cw) / 2;
+                a0 = 1 + alpha; a1 = -2 * cw; a2 = 1 - alpha;
+                break;
+            case EQ_PEAK:
+                b0 = 1 + alpha * A; b1 = -2 * cw; b2 = 1 - alpha * A;
+                a0 = 1 + alpha / A; a1 = -2 * cw; a2 = 1 - alpha / A;
+                break;
+            default: { // EQ_HIGHSHELF
+                float sa = 2 * sqrtf(A) * alpha;
+                b0 = A * ((A + 1) + (A - 1) * cw + sa);
+                b1 = -2 * A * ((A - 1) + (A + 1) * cw);
+                b2 = A * ((A + 1) + (A - 1) * cw - sa);
+                a0 = (A + 1) - (A - 1) * cw + sa;
+                a1 = 2 * ((A - 1) - (A + 1) * cw);
+                a2 = (A + 1) - (A - 1) * cw - sa;
+                break;
+            }
+        }
+
+        // The make-up gain rides on the first section for free
+        float g = (i == 0) ? makeup : 1.0f;
+        eq[i].b0 = toQ28(g * b0 / a0);
+        eq[i].b1 = toQ28(g * b1 / a0);
+        eq[i].b2 = toQ28(g * b2 / a0);
+        eq[i].a1 = toQ28(a1 / a0);
+        eq[i].a2 = toQ28(a2 / a0);
+    }
+
+    float release = 1.0f - expf(-1000.0f / (LIMITER_RELEASE_MS * (float)AUDIO_SAMPLE_RATE));
+    releaseCoef = (int32_t)(release * (float)(1 << 30));
+
+    reset();
+}
+
+void OutputChain::reset() {
+    for (int i = 0; i < OUTPUT_EQ_SECTIONS; i++) {
+        eq[i].x1 = eq[i].x2 = eq[i].y1 = eq[i].y2 = 0;
+    }
+    memset(delay, 0, sizeof(delay));
+    delayPos = 0;
+    gain = gainTarget = 1 << 30;
+    gainStep = 0;
+    hold = 0;
+}
+
+void OutputChain::process(int32_t* block, size_t frames) {
+    equalize(block, frames);
+    limit(block, frames);
+}
+
+// Direct form I, one section at a time over the whole block
+void OutputChain::equalize(int32_t* block, size_t frames) {
+    for (int s = 0; s < OUTPUT_EQ_SECTIONS; s++) {
+        Biquad& f = eq[s];
+        int32_t x1 = f.x1, x2 = f.x2, y1 = f.y1, y2 = f.y2;
+        for (size_t i = 0; i < frames; i++) {
+            int32_t x = block[i];
+            int64_t acc = (int64_t)f.b0 * x + (int64_t)f.b1 * x1 + (int64_t)f.b2 * x2
+                        - (int64_t)f.a1 * y1 - (int64_t)f.a2 * y2;
+            int32_t y = (int32_t)(acc >> 28);
+            x2 = x1; x1 = x;
+            y2 = y1; y1 = y;
+            block[i] = y;
+        }
+        f.x1 = x1; f.x2 = x2; f.y1 = y1; f.y2 = y2;
+    }
+}
+
+// Each sample is delayed by LIMITER_LOOKAHEAD. A peak seen on input starts a
+// linear gain ramp that reaches the gain it needs exactly when it comes out,
+// the gain holds until the peak has passed, then releases exponentially.
+void OutputChain::limit(int32_t* block, size_t frames) {
+    const int32_t unity = 1 << 30;
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t in = block[i];
+        int32_t out = delay[delayPos];
+        delay[delayPos] = in;
+        delayPos = (delayPos + 1) & (LIMITER_LOOKAHEAD - 1);
+
+        int32_t peak = in < 0 ? -in : in;
+        if (peak > LIMITER_CEILING) {
+            // 32-bit divide (a 64-bit one is a slow libgcc call on the ESP32)
+            int32_t needed = ((LIMITER_CEILING << 15) / peak) << 15;
+            if (needed < gainTarget) gainTarget = needed;
+            int32_t step = (gain - needed) / LIMITER_LOOKAHEAD + 1;
+            if (step > gainStep) gainStep = step; // Never slower than an earlier peak needs
+            hold = LIMITER_LOOKAHEAD;
+        }
+
+        if (gain > gainTarget) {
+            gain -= gainStep;
+            if (gain <= gainTarget) {
+                gain = gainTarget;
+                gainStep = 0;
+            }
+        } else if (hold == 0) {
+            gainTarget = unity;
+            gain += mulQ30(unity - gain, releaseCoef);
+        }
+        if (hold) hold--;
+
+        int32_t y = mulQ30(out, gain);
+        if (y > LIMITER_CEILING) y = LIMITER_CEILING; // Rounding only
+        else if (y < -LIMITER_CEILING) y = -LIMITER_CEILING;
+        block[i] = y;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef OUTPUTCHAIN_H
+#define OUTPUTCHAIN_H
+
+#include <Arduino.h>
+
+// --- CONFIG ---
+#define OUTPUT_EQ_SECTIONS 3      // Biquads, see speakerEq in OutputChain.cpp
+#define OUTPUT_MAKEUP_DB 6        // Boost ahead of the limiter
+#define LIMITER_LOOKAHEAD 32      // Frames (~0.7 ms, power of two), also the added latency
+#define LIMITER_CEILING 31000     // Peak output (~-0.5 dBFS)
+#define LIMITER_RELEASE_MS 50
+// --------------
+
+// Speaker processing between the voice mix and the master volume.
+// A few biquad EQ sections tailor the sound to small speakers (no energy
+// spent on bass they cannot play, a lift where they are efficient), then a
+// make-up gain and a look-ahead peak limiter make clicks louder while no
+// sample ever exceeds LIMITER_CEILING. The master volume only attenuates
+// after that, so the output can no longer clip.
+//
+// Coefficients are designed once (float), the per-sample path is fixed
+// point: Q28 coefficients and 32x32 -> 64-bit products, Q30 limiter gain.
+class OutputChain {
+public:
+    OutputChain();
+
+    // Clears filter and limiter state (on enabling, so old audio is not replayed)
+    void reset();
+
+    // Processes one block in place. Output stays within +-LIMITER_CEILING.
+    void process(int32_t* block, size_t frames);
+
+private:
+    struct Biquad {
+        int32_t b0, b1, b2, a1, a2; // Q28, a0 normalized to 1
+        int32_t x1, x2, y1, y2;
+    };
+
+    Biquad eq[OUTPUT_EQ_SECTIONS];
+
+    int32_t delay[LIMITER_LOOKAHEAD];
+    uint32_t delayPos = 0;
+    int32_t gain = 1 << 30;     // Q30, applied to the delayed samples
+    int32_t gainTarget = 1 << 30;
+    int32_t gainStep = 0;       // Per sample while attacking
+    uint32_t hold = 0;          // Frames until the last peak has left the delay
+    int32_t releaseCoef;        // Q30 share of the remaining distance per sample
+
+    void equalize(int32_t* block, size_t frames);
+    void limit(int32_t* block, size_t frames);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PCM_CONVERT_H
+#define PCM_CONVERT_H
+
+#include <Arduino.h>
+
+// WAV sample data to mono 16-bit, as the loader converts it.
+// One kernel per input format, picked once per file, so the inner loop has no
+// format branches. Kernels take whole frames.
+namespace Pcm {
+    typedef void (*Kernel)(const uint8_t* src, size_t frames, int16_t* out);
+
+    // Reads one little-endian PCM sample as 16-bit signed
+    template <int Bytes> inline int32_t decode(const uint8_t* p);
+    template <> inline int32_t decode<1>(const uint8_t* p) { return ((int32_t)p[0] - 128) << 8; } // 8-bit unsigned
+    template <> inline int32_t decode<2>(const uint8_t* p) { return (int16_t)(p[0] | (p[1] << 8)); }
+
+    // Stereo is downmixed to the average of both channels
+    template <int Bytes, int Channels>
+    void convert(const uint8_t* src, size_t frames, int16_t* out) {
+        for (size_t i = 0; i < frames; i++, src += Bytes * Channels) {
+            int32_t val = decode<Bytes>(src);
+            if (Channels == 2) val = (val + decode<Bytes>(src + Bytes)) >> 1;
+            out[i] = (int16_t)val;
+        }
+    }
+
+    // Mono 16-bit is already the working format (the ESP32 is little endian)
+    template <>
+    inline void convert<2, 1>(const uint8_t* src, size_t frames, int16_t* out) {
+        memcpy(out, src, frames * sizeof(int16_t));
+    }
+
+    // nullptr for formats the loader does not read
+    inline Kernel pickKernel(uint16_t bytesPerSample, uint16_t channels) {
+        if (bytesPerSample == 2) return channels == 2 ? convert<2, 2> : convert<2, 1>;
+        if (bytesPerSample == 1) return channels == 2 ? convert<1, 2> : convert<1, 1>;
+        return nullptr;
+    }
+}
+
+#endif
@@ -6,10 +6,19 @@
 #include <FS.h>
 #include <LittleFS.h>
 
+enum RampCurve {
+  RAMP_LINEAR,     // Same bpm change every beat
+  RAMP_EXPONENTIAL // Same bpm ratio every beat
+};
+
 struct SequenceStep {
   int bars;
   int beatsPerBar;
   int bpm;
+  int endBpm; // Tempo ramp: bpm of the step's last beat (0 = steady)
+  int curve;  // RampCurve
+
+  bool isRamp() const { return endBpm > 0 && endBpm != bpm; }
 };
 
 class ProgramManager {
@@ -97,8 +106,13 @@ public:
         // Write Sound Header
         file.printf("SOUNDS:%s,%s\n", dbPath.c_str(), bPath.c_str());
 
+        // bars,beatsPerBar,bpm[,endBpm,curve]
         for (const auto& step : sequence) {
-            file.printf("%d,%d,%d\n", step.bars, step.beatsPerBar, step.bpm);
+            if (step.isRamp()) {
+                file.printf("%d,%d,%d,%d,%d\n", step.bars, step.beatsPerBar, step.bpm, step.endBpm, step.curve);
+            } else {
+                file.printf("%d,%d,%d\n", step.bars, step.beatsPerBar, step.bpm);
+            }
         }
         file.close();
         return true;
@@ -125,13 +139,18 @@ public:
                         bPath = sounds.substring(comma + 1);
                     }
                 } else {
-                    int c1 = line.indexOf(',');
-                    int c2 = line.lastIndexOf(',');
-                    if (c1 > 0 && c2 > c1) {
-                        int bars = line.substring(0, c1).toInt();
-                        int bpb = line.substring(c1 + 1, c2).toInt();
-                        int bpm = line.substring(c2 + 1).toInt();
-                        sequence.push_back({bars, bpb, bpm});
+                    // bars,beatsPerBar,bpm and optionally endBpm,curve
+                    int values[5] = {0, 0, 0, 0, RAMP_LINEAR};
+                    int count = 0;
+                    int from = 0;
+                    while (count < 5) {
+                        int comma = line.indexOf(',', from);
+                        values[count++] = line.substring(from, comma < 0 ? line.length() : comma).toInt();
+                        if (comma < 0) break;
+                        from = comma + 1;
+                    }
+                    if (count >= 3) {
+                        sequence.push_back({values[0], values[1], values[2], values[3], values[4]});
                     }
                 }
             }
@@ -0,0 +1,64 @@
+#include "Resampler.h"
+#include <math.h>
+
+#define PHASE_ONE 65536u
+#define PHASE_SHIFT 11 // 16 - log2(RESAMPLER_PHASES)
+
+bool Resampler::configure(uint32_t inRate, uint32_t outRate) {
+    if (inRate == outRate || inRate == 0) return false;
+
+    step = (uint32_t)(((uint64_t)inRate << 16) / outRate);
+    memset(history, 0, sizeof(history));
+    head = 0;
+    // The window center reaches the first input sample after TAPS/2 - 1 pushes
+    phase = (RESAMPLER_TAPS / 2 - 1) * PHASE_ONE;
+
+    // Cutoff below the lower of the two Nyquist frequencies
+    float cutoff = (inRate > outRate) ? (float)outRate / inRate : 1.0f;
+    cutoff *= 0.92f;
+
+    for (int p = 0; p < RESAMPLER_PHASES; p++) {
+        float center = RESAMPLER_TAPS / 2 - 1 + (float)p / RESAMPLER_PHASES;
+        float taps[RESAMPLER_TAPS];
+        float sum = 0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            float d = k - center;
+            float x = M_PI * cutoff * d;
+            float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf(x) / x;
+            float w = 0.42f + 0.5f * cosf(2 * M_PI * d / RESAMPLER_TAPS) + 0.08f * cosf(4 * M_PI * d / RESAMPLER_TAPS);
+            taps[k] = sinc * w;
+            sum += taps[k];
+        }
+        for (int k = 0; k < RESAMPLER_TAPS; k++) {
+            coeffs[p][k] = (int16_t)lrintf(taps[k] / sum * 16384.0f);
+        }
+    }
+    return true;
+}
+
+size_t Resampler::push(int16_t sample, int16_t* out) {
+    history[head] = sample;
+    history[head + RESAMPLER_TAPS] = sample;
+    head = (head + 1) & (RESAMPLER_TAPS - 1);
+
+    const int16_t* window = &history[head]; // Oldest .. newest
+    size_t count = 0;
+    while (phase < PHASE_ONE) {
+        const int16_t* c = coeffs[phase >> PHASE_SHIFT];
+        int32_t acc = 0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++) acc += window[k] * c[k];
+        acc = (acc + (1 << 13)) >> 14;
+        if (acc > 32767) acc = 32767;
+        else if (acc < -32768) acc = -32768;
+        out[count++] = (int16_t)acc;
+        phase += step;
+    }
+    phase -= PHASE_ONE;
+    return count;
+}
+
+size_t Resampler::flush(int16_t* out) {
+    size_t count = 0;
+    for (int i = 0; i < RESAMPLER_TAPS / 2; i++) count += push(0, out + count);
+    return count;
+}
@@ -0,0 +1,40 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <Arduino.h>
+
+// --- CONFIG ---
+#define RESAMPLER_TAPS 16      // FIR length per output sample (power of two)
+#define RESAMPLER_PHASES 32    // Sub-sample positions of the polyphase table
+#define RESAMPLER_MIN_RATE 8000
+// --------------
+
+// Outputs a single push() can produce at RESAMPLER_MIN_RATE -> 48 kHz
+#define RESAMPLER_MAX_OUTPUT 8
+
+// Streaming windowed-sinc (Blackman) polyphase resampler for mono 16-bit PCM.
+// Used at load time to bring every sound to the output rate. Coefficients are
+// designed once per file (float), the per-sample path is pure fixed point:
+// Q14 taps, Q16 phase accumulator, 32-bit multiply-accumulate.
+class Resampler {
+public:
+    // Prepares a conversion. Returns false if the rates match (nothing to do).
+    bool configure(uint32_t inRate, uint32_t outRate);
+
+    // Feeds one input sample and writes the output samples that became due.
+    // out must hold RESAMPLER_MAX_OUTPUT samples. Returns how many were written.
+    size_t push(int16_t sample, int16_t* out);
+
+    // Drains the filter delay at the end of a sound. out must hold
+    // RESAMPLER_MAX_OUTPUT * RESAMPLER_TAPS / 2 samples.
+    size_t flush(int16_t* out);
+
+private:
+    int16_t coeffs[RESAMPLER_PHASES][RESAMPLER_TAPS]; // Q14, each row sums to 1.0
+    int16_t history[2 * RESAMPLER_TAPS]; // Mirrored ring, window is always contiguous
+    uint8_t head = 0;
+    uint32_t phase = 0; // Q16 offset of the next output past the window center
+    uint32_t step = 0;  // Q16 input samples per output sample
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "SampleBank.h"
+
+bool SampleBank::begin(uint16_t sampleBits, uint32_t sampleRate) {
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SAMPLE_BANK_LABEL);
+    if (!partition) {
+        Serial.println("Sample bank: no partition");
+        return false;
+    }
+
+    // Check the header before mapping anything
+    BankHeader h;
+    if (esp_partition_read(partition, 0, &h, sizeof(h)) != ESP_OK) return false;
+    if (memcmp(h.magic, "MBNK", 4) != 0 || h.version != SAMPLE_BANK_VERSION) {
+        Serial.println("Sample bank: empty or unknown format");
+        return false;
+    }
+    if (h.sampleBits != sampleBits || h.sampleRate != sampleRate) {
+        Serial.print("Sample bank: built for "); Serial.print(h.sampleBits);
+        Serial.print("-bit "); Serial.print(h.sampleRate); Serial.println(" Hz, ignored");
+        return false;
+    }
+    if (h.totalSize > partition->size || sizeof(BankHeader) + (uint64_t)h.setCount * sizeof(BankSet) > h.totalSize) {
+        Serial.println("Sample bank: corrupt header");
+        return false;
+    }
+
+    const void* mapped;
+    if (esp_partition_mmap(partition, 0, h.totalSize, SPI_FLASH_MMAP_DATA, &mapped, &mapHandle) != ESP_OK) {
+        Serial.println("Sample bank: mmap failed");
+        return false;
+    }
+    base = (const uint8_t*)mapped;
+    header = (const BankHeader*)base;
+
+    if (!isValid()) {
+        Serial.println("Sample bank: corrupt set table");
+        spi_flash_munmap(mapHandle);
+        base = nullptr;
+        header = nullptr;
+        return false;
+    }
+    sets = (const BankSet*)(base + sizeof(BankHeader));
+
+    Serial.print("Sample bank: "); Serial.print(h.setCount);
+    Serial.print(" sets, "); Serial.print(h.totalSize); Serial.println(" bytes mapped");
+    return true;
+}
+
+bool SampleBank::isValid() const {
+    const BankSet* table = (const BankSet*)(base + sizeof(BankHeader));
+    for (uint32_t i = 0; i < header->setCount; i++) {
+        if (table[i].name[SAMPLE_BANK_NAME_LEN - 1] != '\0') return false;
+        for (int slot = 0; slot < 2; slot++) {
+            if ((table[i].offset[slot] & 3) != 0) return false;
+            if ((uint64_t)table[i].offset[slot] + table[i].size[slot] > header->totalSize) return false;
+        }
+    }
+    return true;
+}
+
+String SampleBank::name(size_t set) const {
+    if (set >= count()) return String();
+    return String(sets[set].name);
+}
+
+int SampleBank::find(const String& name) const {
+    for (size_t i = 0; i < count(); i++) {
+        if (strcmp(sets[i].name, name.c_str()) == 0) return (int)i;
+    }
+    return -1;
+}
+
+const uint8_t* SampleBank::samples(size_t set, BankSlot slot, size_t& size, uint32_t& onset) const {
+    if (set >= count()) {
+        size = 0;
+        onset = 0;
+        return nullptr;
+    }
+    size = sets[set].size[slot];
+    onset = sets[set].onset[slot];
+    return base + sets[set].offset[slot];
+}
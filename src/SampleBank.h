@@ -0,0 +1,63 @@
+#ifndef SAMPLEBANK_H
+#define SAMPLEBANK_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Prebuilt sound sets in their own flash partition (built by scripts/build_bank.py).
+// The partition is memory-mapped once at boot and the mixer plays straight
+// from flash, so selecting a set neither reads files nor touches the heap.
+//
+// Layout (little endian, all offsets from the partition start):
+//   BankHeader, BankSet[setCount], then the samples (4-byte aligned),
+//   already mono at sampleRate in the output sample format and trimmed
+//   like sounds loaded from LittleFS.
+
+#define SAMPLE_BANK_LABEL "bank"
+#define SAMPLE_BANK_VERSION 2
+#define SAMPLE_BANK_NAME_LEN 24
+
+enum BankSlot {
+    BANK_DOWNBEAT = 0,
+    BANK_BEAT = 1
+};
+
+struct BankHeader {
+    char magic[4];       // "MBNK"
+    uint16_t version;
+    uint16_t sampleBits; // 16 = signed, 8 = unsigned
+    uint32_t sampleRate;
+    uint32_t setCount;
+    uint32_t totalSize;  // Bytes used in the partition
+};
+
+struct BankSet {
+    char name[SAMPLE_BANK_NAME_LEN]; // NUL terminated
+    uint32_t offset[2];              // Indexed by BankSlot
+    uint32_t size[2];                // Bytes
+    uint32_t onset[2];               // Start to perceived onset, in samples
+};
+
+class SampleBank {
+public:
+    // Maps the bank if it exists and matches the given output format
+    bool begin(uint16_t sampleBits, uint32_t sampleRate);
+    bool isMounted() const { return sets != nullptr; }
+
+    size_t count() const { return isMounted() ? header->setCount : 0; }
+    String name(size_t set) const;
+    int find(const String& name) const; // -1 if missing
+
+    // Samples of one sound, valid for as long as the firmware runs
+    const uint8_t* samples(size_t set, BankSlot slot, size_t& size, uint32_t& onset) const;
+
+private:
+    const uint8_t* base = nullptr;
+    const BankHeader* header = nullptr;
+    const BankSet* sets = nullptr;
+    spi_flash_mmap_handle_t mapHandle = 0;
+
+    bool isValid() const;
+};
+
+#endif
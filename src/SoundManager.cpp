@@ -1,28 +1,32 @@
 #include "SoundManager.h"
 
-#include <SPI.h>
+#include "AllocDebug.h"
 
+#include "PcmConvert.h"
 
+#include "TaskMonitor.h"
 
-SoundManager soundManager;
+#include <esp_timer.h>
+
+#include <SPI.h>
 
 
 
-hw_timer_t * timer = NULL;
+SoundManager soundManager;
 
-portMUX_TYPE timerMux = portMUX_INITIALIZER_UNLOCKED;
 
 
+static inline uint32_t fnv1a(uint32_t hash, const uint8_t* p, size_t n) {
 
-// Forward declaration of interrupt handler
+    for (size_t i = 0; i < n; i++) {
 
-void IRAM_ATTR onTimer() {
+        hash ^= p[i];
 
-    portENTER_CRITICAL_ISR(&timerMux);
+        hash *= 16777619u;
 
-    soundManager.handleInterrupt();
+    }
 
-    portEXIT_CRITICAL_ISR(&timerMux);
+    return hash;
 
 }
 
@@ -32,81 +36,57 @@ SoundManager::SoundManager() {}
 
 
 
-#ifdef USE_I2S_AUDIO
-
-// I2S Task removed (Tone Gen)
-
-#endif
-
-
-
-bool SoundManager::begin() {
-
-    if(!LittleFS.begin(true)){
-
-        Serial.println("LittleFS Mount Failed");
-
-        return false;
-
-    }
+// Mixer task: owns the output and renders one block at a time.
 
-    
+// Blocking in OutputBackend::write() (on the I2S DMA) is what paces it.
 
-    prefs.begin("metronome", false);
+void SoundManager::audioTask(void* param) {
 
+    ((SoundManager*)param)->runAudio();
 
+}
 
-    #ifdef USE_I2S_AUDIO
 
-    Serial.println("Initializing I2S...");
 
-    i2s_config_t i2s_config = {
+// Loader task: owns the sound cache, the read buffer and the resampler.
 
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
+// Reads and converts sounds while the mixer keeps playing the old ones.
 
-        .sample_rate = 44100,
+void SoundManager::loaderTask(void* param) {
 
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+    ((SoundManager*)param)->runLoader();
 
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT, // Mono
+}
 
-        .communication_format = I2S_COMM_FORMAT_I2S, // Standard I2S
 
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
 
-        .dma_buf_count = 8,
+bool SoundManager::begin() {
 
-        .dma_buf_len = 64,
+    if(!LittleFS.begin(true)){
 
-        .use_apll = false,
+        Serial.println("LittleFS Mount Failed");
 
-        .tx_desc_auto_clear = true // Auto clear to avoid noise
+        return false;
 
-    };
+    }
 
     
 
-    i2s_pin_config_t pin_config = {
-
-        .bck_io_num = I2S_BCLK,
+    prefs.begin("metronome", false);
 
-        .ws_io_num = I2S_LRCK,
+    soundLevel[SOUND_DOWNBEAT] = prefs.getUChar("levelDownbeat", 255);
 
-        .data_out_num = I2S_DOUT,
+    soundLevel[SOUND_BEAT] = prefs.getUChar("levelBeat", 255);
 
-        .data_in_num = I2S_PIN_NO_CHANGE
+    outputChainEnabled = prefs.getBool("outputChain", outputChainEnabled);
 
-    };
 
-    
 
-    i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL);
+    OutputBackend::begin();
 
-    i2s_set_pin(I2S_NUM, &pin_config);
+    bank.begin(8 * sizeof(AudioSample), AUDIO_SAMPLE_RATE);
 
-    i2s_zero_dma_buffer(I2S_NUM);
-    
-    #endif
+    updateIndex();
 
     
 
@@ -114,6 +94,8 @@ bool SoundManager::begin() {
 
     // User requested to always start with Metro sounds
 
+    // (built into the firmware: no file access, works without uploadfs)
+
     String dbPath = "/Metro_Downbeat.wav";
 
     String bPath = "/Metro_Beat.wav";
@@ -148,31 +130,21 @@ bool SoundManager::begin() {
 
     
 
-    #ifndef USE_I2S_AUDIO
-
-    // Setup Timer for DAC
-
-    // Use Timer 0, divider 80 (1MHz)
-
-    timer = timerBegin(0, 80, true);
-
-    timerAttachInterrupt(timer, &onTimer, true);
+    xTaskCreatePinnedToCore(audioTask, "audio", AUDIO_TASK_STACK, this, AUDIO_TASK_PRIORITY, &audioTaskHandle, AUDIO_TASK_CORE);
 
-    
-
-    // Initialize DAC to center (silence) to avoid pop
+    #ifdef AUDIO_ALLOC_DEBUG
 
-    dacWrite(26, 128);
+    AllocDebug::watchTask(audioTaskHandle);
 
+    #endif
 
+    xTaskCreatePinnedToCore(loaderTask, "loader", LOADER_TASK_STACK, this, LOADER_TASK_PRIORITY, &loaderTaskHandle, LOADER_TASK_CORE);
 
-    // Default alarm (will be updated on play)
+    TaskMonitor::add(TASK_AUDIO, "audio", audioTaskHandle, AUDIO_TASK_STACK, 30);
 
-    timerAlarmWrite(timer, 1000, true); 
+    TaskMonitor::add(TASK_LOADER, "loader", loaderTaskHandle, LOADER_TASK_STACK, 50); // Bursts while loading
 
-    #endif
 
-    
 
     return true;
 
@@ -186,25 +158,35 @@ std::vector<String> SoundManager::listWavs() {
 
     
 
-    Serial.println("--- Listing LittleFS Files ---");
+    // Sets in the sample bank come first, LittleFS adds any others
 
-    
+    for (size_t i = 0; i < bank.count(); i++) {
 
-    File root = LittleFS.open("/");
+        files.push_back(bank.name(i));
+
+    }
 
-    if(!root){
+    // The built-in set is always there
 
-        Serial.println("Failed to open root directory");
+    if (bank.find(BUILTIN_SET_NAME) < 0) files.push_back(BUILTIN_SET_NAME);
 
-        return files;
+    // So are the synth presets (they take precedence over WAV sets of the same name)
+
+    for (size_t i = 0; i < ClickSynth::count(); i++) {
+
+        files.push_back(ClickSynth::preset(i).name);
 
     }
 
-    
 
-    if (!root.isDirectory()) {
 
-        Serial.println("Error: Root is not a directory!");
+    // LittleFS sets come from the library index (one file read)
+
+    File index = LittleFS.open(SOUND_INDEX_PATH, "r");
+
+    if (!index) {
+
+        Serial.println("Sound index missing");
 
         return files;
 
@@ -212,53 +194,59 @@ std::vector<String> SoundManager::listWavs() {
 
 
 
-    File file = root.openNextFile();
+    index.readStringUntil('\n'); // Signature line
 
-    while(file){
+    while (index.available()) {
 
-        String name = String(file.name());
+        String line = index.readStringUntil('\n');
 
-        if(!file.isDirectory()){
+        int comma = line.indexOf(',');
 
-            String upperName = name;
+        if (comma <= 0) continue;
 
-            upperName.toUpperCase();
 
-            if(upperName.endsWith(".WAV")){
 
-                // Only add if it's a Downbeat file to keep list clean
+        String displayName = line.substring(0, comma);
 
-                // We assume matching _Beat.wav exists
+        if (bank.find(displayName) < 0 && displayName != BUILTIN_SET_NAME && ClickSynth::find(displayName) < 0) files.push_back(displayName);
 
-                if (name.indexOf("_Downbeat") > 0) {
+    }
 
-                    // Strip "_Downbeat.wav" for display
+    index.close();
 
-                    String displayName = name.substring(0, name.indexOf("_Downbeat"));
+    return files;
 
-                    // Remove leading slash if present
+}
 
-                    if (displayName.startsWith("/")) displayName = displayName.substring(1);
 
-                    
 
-                    // Check if valid format
+// Hash over the names and sizes of all WAV files in the root directory.
 
-                    if (isValidWav(name)) {
+// Changes whenever sounds are added, removed, renamed or replaced.
 
-                        files.push_back(displayName);
+uint32_t SoundManager::librarySignature() {
 
-                        Serial.print("  -> Added Set: "); Serial.println(displayName);
+    uint32_t hash = 2166136261u;
 
-                    } else {
+    File root = LittleFS.open("/");
 
-                        Serial.print("  -> Skipped Invalid: "); Serial.println(name);
+    if (!root || !root.isDirectory()) return hash;
 
-                    }
 
-                }
 
-            }
+    File file = root.openNextFile();
+
+    while (file) {
+
+        String name = String(file.name());
+
+        if (!file.isDirectory() && (name.endsWith(".wav") || name.endsWith(".WAV"))) {
+
+            uint32_t size = file.size();
+
+            hash = fnv1a(hash, (const uint8_t*)name.c_str(), name.length());
+
+            hash = fnv1a(hash, (const uint8_t*)&size, sizeof(size));
 
         }
 
@@ -266,93 +254,125 @@ std::vector<String> SoundManager::listWavs() {
 
     }
 
-    Serial.println("--- End List ---");
-
-    return files;
+    return hash;
 
 }
 
 
 
-bool SoundManager::isValidWav(String path) {
+// Rebuilds SOUND_INDEX_PATH if the WAV files changed since it was written.
 
-    if (!path.startsWith("/")) path = "/" + path;
+// One line per complete, valid set:
 
-    File file = LittleFS.open(path, "r");
+//   name,downbeatPath,beatPath,rate,channels,bits,downbeatFrames,beatFrames,bytes
 
-    if (!file) return false;
+void SoundManager::updateIndex() {
 
+    uint32_t signature = librarySignature();
 
+    String header = "INDEX:" + String(signature);
 
-    if (file.size() < 44) { file.close(); return false; }
 
 
+    File index = LittleFS.open(SOUND_INDEX_PATH, "r");
 
-    char header[44];
+    if (index) {
 
-    file.read((uint8_t*)header, 44);
+        String stored = index.readStringUntil('\n');
 
-    file.close();
+        index.close();
 
+        if (stored == header) return;
 
+    }
 
-    // Check RIFF
 
-    if (memcmp(header, "RIFF", 4) != 0) return false;
 
-    // Check WAVE
+    Serial.println("Rebuilding sound index...");
 
-    if (memcmp(header + 8, "WAVE", 4) != 0) return false;
+    File root = LittleFS.open("/");
 
-    
+    if (!root || !root.isDirectory()) return;
 
-    // Parse fmt
 
-    // Note: This assumes standard 44 byte header. 
 
-    // If fmt chunk is moved or extra chunks exist, this simple check might fail valid files.
+    index = LittleFS.open(SOUND_INDEX_PATH, FILE_WRITE);
 
-    // But for our standard converted files, it's fine.
+    if (!index) {
 
-    // Let's be slightly more robust by checking fmt signature if possible, 
+        Serial.println("Failed to write sound index");
 
-    // but for speed we'll check the standard offsets first.
+        return;
 
-    
+    }
+
+    index.printf("%s\n", header.c_str());
 
-    // AudioFormat (Offset 20, 2 bytes) -> Must be 1 (PCM)
 
-    uint16_t fmtCode = (uint16_t)(header[20] | (header[21] << 8));
 
-    if (fmtCode != 1) return false;
+    int sets = 0;
 
+    File file = root.openNextFile();
 
+    while (file) {
 
-    // Channels (Offset 22, 2 bytes) -> Must be 1 or 2
+        String name = String(file.name());
 
-    uint16_t channels = (uint16_t)(header[22] | (header[23] << 8));
+        if (name.startsWith("/")) name = name.substring(1);
 
-    if (channels > 2) return false; 
+        file = root.openNextFile();
 
 
 
-    // Sample Rate (Offset 24, 4 bytes) -> Max 48000
+        if (!name.endsWith("_Downbeat.wav")) continue;
 
-    uint32_t sampleRate = (uint32_t)(header[24] | (header[25] << 8) | (header[26] << 16) | (header[27] << 24));
+        String displayName = name.substring(0, name.length() - strlen("_Downbeat.wav"));
 
-    if (sampleRate > 48000) return false;
+        String dbPath = "/" + name;
 
+        String bPath = "/" + displayName + "_Beat.wav";
 
 
-    // BitsPerSample (Offset 34, 2 bytes) -> Max 16
 
-    uint16_t bits = (uint16_t)(header[34] | (header[35] << 8));
+        WavInfo db, b;
 
-    if (bits > 16) return false;
+        if (!readWavInfo(dbPath, db) || !readWavInfo(bPath, b)) {
 
+            Serial.print("  -> Skipped Invalid: "); Serial.println(displayName);
 
+            continue;
 
-    return true;
+        }
+
+        index.printf("%s,%s,%s,%u,%u,%u,%u,%u,%u\n", displayName.c_str(), dbPath.c_str(), bPath.c_str(),
+
+                     (unsigned)db.sampleRate, (unsigned)db.channels, (unsigned)db.bitsPerSample,
+
+                     (unsigned)db.frames(), (unsigned)b.frames(), (unsigned)(db.dataSize + b.dataSize));
+
+        sets++;
+
+    }
+
+    index.close();
+
+    Serial.print("Sound index: "); Serial.print(sets); Serial.println(" sets");
+
+}
+
+
+
+bool SoundManager::readWavInfo(String path, WavInfo& info) {
+
+    File file = LittleFS.open(path, "r");
+
+    if (!file) return false;
+
+    WavStatus status = WavParser::parse(file, info);
+
+    file.close();
+
+    return status == WAV_OK;
 
 }
 
@@ -364,31 +384,31 @@ bool SoundManager::loadSound(SoundType type, String fullPath) {
 
     
 
-    bool success = false;
+    String& currentPath = (type == SOUND_DOWNBEAT) ? currentDownbeatPath : currentBeatPath;
 
-    if (type == SOUND_DOWNBEAT) {
 
-        if (loadWavToBuffer(fullPath, downbeat)) {
 
-            currentDownbeatPath = fullPath;
+    if (!loaderTaskHandle) {
 
-            success = true;
+        // Still in begin(): nothing is playing yet, load in place
 
-        }
+        if (!loadInto(fullPath, *activeSound[type])) return false;
 
-    } else {
+        loadedPath[type] = fullPath;
 
-        if (loadWavToBuffer(fullPath, beat)) {
+        currentPath = fullPath;
 
-            currentBeatPath = fullPath;
+        return true;
 
-            success = true;
+    }
 
-        }
 
-    }
 
-    return success;
+    if (!requestLoad((LoadTarget)type, fullPath)) return false;
+
+    currentPath = fullPath;
+
+    return true;
 
 }
 
@@ -422,623 +442,1878 @@ bool SoundManager::selectSound(SoundType type, String filename) {
 
 
 
-bool SoundManager::loadWavToBuffer(String path, AudioBuffer& buffer) {
+bool SoundManager::loadInto(const String& path, AudioBuffer& buffer) {
 
-    if (!LittleFS.exists(path)) return false;
+    return loadBuiltin(path, buffer) || loadSynth(path, buffer) || loadFromBank(path, buffer) || loadStored(path, buffer);
 
-    File file = LittleFS.open(path, "r");
+}
 
-    if (!file) return false;
 
-    
 
-    // Simple WAV parsing
+// Points the buffer at a synth preset: "/<Preset>_Downbeat.wav" plays the
 
-    file.seek(12); // Skip RIFF header
+// accented variant. Nothing is stored, the mixer renders it on the fly.
 
-    
+bool SoundManager::loadSynth(const String& path, AudioBuffer& buffer) {
 
-    bool foundFmt = false;
+    bool accent;
 
-    bool foundData = false;
+    if (path.endsWith("_Downbeat.wav")) accent = true;
 
-    
+    else if (path.endsWith("_Beat.wav")) accent = false;
 
-    while (file.available()) {
+    else return false;
 
-        char chunkID[4];
 
-        file.read((uint8_t*)chunkID, 4);
 
-        uint32_t chunkSize;
+    int index = ClickSynth::find(path.substring(1, path.lastIndexOf('_')));
 
-        file.read((uint8_t*)&chunkSize, 4);
+    if (index < 0) return false;
 
-        
+    const SynthPreset& preset = ClickSynth::preset(index);
 
-        if (memcmp(chunkID, "fmt ", 4) == 0) {
 
-            uint16_t fmtCode; file.read((uint8_t*)&fmtCode, 2);
 
-            uint16_t channels; file.read((uint8_t*)&channels, 2);
+    releaseBuffer(buffer);
 
-            uint32_t sampleRate; file.read((uint8_t*)&sampleRate, 4);
 
-            uint32_t byteRate; file.read((uint8_t*)&byteRate, 4);
 
-            uint16_t blockAlign; file.read((uint8_t*)&blockAlign, 2);
+    buffer.size = sizeof(SynthPreset);
 
-            uint16_t bitsPerSample; file.read((uint8_t*)&bitsPerSample, 2);
+    buffer.frames = ClickSynth::frames(preset, accent);
 
-            
+    buffer.onsetFrames = 0; // Starts at full level
 
-            Serial.print("WAV Format: Code="); Serial.print(fmtCode);
+    buffer.format = SAMPLE_SYNTH;
 
-            Serial.print(", Chan="); Serial.print(channels);
+    buffer.sampleRate = AUDIO_SAMPLE_RATE;
 
-            Serial.print(", Rate="); Serial.print(sampleRate);
+    buffer.channels = 1;
 
-            Serial.print(", Bits="); Serial.println(bitsPerSample);
+    buffer.bitsPerSample = 16;
 
+    buffer.ownsData = false;
 
+    buffer.accent = accent;
 
-            if (fmtCode != 1) {
+    buffer.data = (uint8_t*)&preset;
 
-                Serial.println("Error: Unsupported WAV format (Compressed/Float). Must be PCM (1).");
 
-                file.close();
 
-                return false;
+    Serial.print("Synth: "); Serial.println(path);
 
-            }
+    return true;
 
+}
 
 
-            // Safety Check: Reject High-Res files to prevent RAM overflow/Crash
 
-            if (sampleRate > 48000 || bitsPerSample > 16) {
+// Points the buffer at the default set compiled into the firmware
 
-                Serial.println("Error: File format too high for RAM! (Max 48kHz, 16-bit)");
+bool SoundManager::loadBuiltin(const String& path, AudioBuffer& buffer) {
 
-                file.close();
+    SoundType type;
 
-                return false;
+    if (path == "/" BUILTIN_SET_NAME "_Downbeat.wav") type = SOUND_DOWNBEAT;
 
-            }
+    else if (path == "/" BUILTIN_SET_NAME "_Beat.wav") type = SOUND_BEAT;
 
+    else return false;
 
 
-            buffer.sampleRate = sampleRate;
 
-            buffer.channels = channels;
+    // Only the array matching the output format is referenced (and linked)
 
-            buffer.bitsPerSample = bitsPerSample;
+    const uint8_t* samples;
 
-            
+    if (sizeof(AudioSample) == 2) {
 
-            // Skip any extra fmt bytes
+        samples = (const uint8_t*)(type == SOUND_DOWNBEAT ? builtinDownbeat16 : builtinBeat16);
 
-            if (chunkSize > 16) file.seek(file.position() + chunkSize - 16);
+    } else {
 
-            foundFmt = true;
+        samples = type == SOUND_DOWNBEAT ? builtinDownbeat8 : builtinBeat8;
 
-        } else if (memcmp(chunkID, "data", 4) == 0) {
+    }
 
-            if (buffer.data) free(buffer.data);
 
-            
 
-            #ifdef USE_I2S_AUDIO
+    releaseBuffer(buffer);
 
-            // I2S Mode: Keep 16-bit signed
 
-            uint32_t targetSize = chunkSize;
 
-            // If 8-bit, size doubles. If 16-bit, same. If 24-bit, 2/3.
+    buffer.size = builtinFrames[type] * sizeof(AudioSample);
 
-            if (buffer.bitsPerSample == 8) targetSize = chunkSize * 2;
+    buffer.frames = builtinFrames[type];
 
-            else if (buffer.bitsPerSample == 24) targetSize = (chunkSize / 3) * 2;
+    buffer.onsetFrames = builtinOnset[type];
 
-            #else
+    buffer.format = SAMPLE_PCM;
 
-            // DAC Mode: Convert to 8-bit unsigned
+    buffer.sampleRate = AUDIO_SAMPLE_RATE;
 
-            uint32_t targetSize = chunkSize;
+    buffer.channels = 1;
 
-            if (buffer.bitsPerSample == 16) targetSize = chunkSize / 2;
+    buffer.bitsPerSample = 8 * sizeof(AudioSample);
 
-            else if (buffer.bitsPerSample == 24) targetSize = chunkSize / 3;
+    buffer.ownsData = false;
 
-            #endif
+    buffer.data = (uint8_t*)samples; // Read-only flash, never written through
 
-            
 
-            // Limit size to available RAM (safety margin)
 
-            size_t freeHeap = ESP.getFreeHeap();
+    Serial.print("Built in: "); Serial.println(path);
 
-            if (targetSize > freeHeap - 40000) {
+    return true;
 
-                Serial.println("Error: WAV file too large for RAM!");
+}
 
-                Serial.print("Required: "); Serial.print(targetSize);
 
-                Serial.print(", Free: "); Serial.println(freeHeap);
 
-                file.close();
+// Points the buffer at a sound in the sample bank. Nothing is copied: the
 
-                return false;
+// mixer reads the samples straight from mapped flash.
 
-            }
+bool SoundManager::loadFromBank(String path, AudioBuffer& buffer) {
 
+    if (!bank.isMounted()) return false;
 
 
-            buffer.size = targetSize;
 
-            buffer.data = (uint8_t*)malloc(targetSize);
+    // "/<Set>_Downbeat.wav" or "/<Set>_Beat.wav"
 
-            
+    String name = path.startsWith("/") ? path.substring(1) : path;
 
-            if (buffer.data) {
+    BankSlot slot;
 
-                // Read and convert on the fly
+    if (name.endsWith("_Downbeat.wav")) slot = BANK_DOWNBEAT;
 
-                uint8_t* tempBuf = (uint8_t*)malloc(512);
+    else if (name.endsWith("_Beat.wav")) slot = BANK_BEAT;
 
-                if (!tempBuf) {
+    else return false;
 
-                    Serial.println("Error: Temp Malloc failed!");
 
-                    free(buffer.data); buffer.data = nullptr;
 
-                    file.close(); return false;
+    int set = bank.find(name.substring(0, name.lastIndexOf('_')));
 
-                }
+    if (set < 0) return false;
 
 
 
-                size_t bytesRead = 0;
+    size_t size;
 
-                size_t outIndex = 0;
+    uint32_t onset;
 
-                
+    const uint8_t* samples = bank.samples(set, slot, size, onset);
 
-                while (bytesRead < chunkSize) {
 
-                    size_t toRead = chunkSize - bytesRead;
 
-                    if (toRead > 512) toRead = 512;
+    releaseBuffer(buffer);
 
-                    file.read(tempBuf, toRead);
 
-                    
 
-                    #ifdef USE_I2S_AUDIO
+    buffer.size = size;
 
-                    // Convert to 16-bit signed
+    buffer.frames = size / sizeof(AudioSample);
 
-                    for (size_t i = 0; i < toRead; ) {
+    buffer.onsetFrames = onset < ONSET_MAX_LEAD ? onset : ONSET_MAX_LEAD;
 
-                        int16_t val = 0;
+    buffer.format = SAMPLE_PCM;
 
-                        if (buffer.bitsPerSample == 16) {
+    buffer.sampleRate = AUDIO_SAMPLE_RATE;
 
-                             // Already 16-bit signed
+    buffer.channels = 1;
 
-                             val = (int16_t)(tempBuf[i] | (tempBuf[i+1] << 8));
+    buffer.bitsPerSample = 8 * sizeof(AudioSample);
 
-                             i += 2;
+    buffer.ownsData = false;
 
-                        } else if (buffer.bitsPerSample == 24) {
+    buffer.data = (uint8_t*)samples; // Read-only flash, never written through
 
-                             // 24-bit signed -> 16-bit signed (drop LSB)
 
-                             val = (int16_t)(tempBuf[i+1] | (tempBuf[i+2] << 8));
 
-                             i += 3;
+    Serial.print("From sample bank: "); Serial.println(path);
 
-                        } else {
+    return true;
 
-                             // 8-bit unsigned -> 16-bit signed
+}
 
-                             // (val - 128) * 256
 
-                             val = ((int16_t)tempBuf[i] - 128) << 8;
 
-                             i += 1;
+// Loads a LittleFS sound through the sound cache. A path that was loaded
 
-                        }
+// before is reused without touching flash. Otherwise the file is converted
 
-                        
+// (and hashed in the same pass). If the cache already holds the same audio,
 
-                        // Store as bytes (Little Endian)
+// e.g. a set whose _Beat and _Downbeat files are the same, the new copy is
 
-                        if (outIndex < buffer.size) {
+// dropped and the cached one shared. Its path is remembered with it, so
 
-                            buffer.data[outIndex++] = val & 0xFF;
+// every file with that audio is read and stored only once.
 
-                            buffer.data[outIndex++] = (val >> 8) & 0xFF;
+bool SoundManager::loadStored(String path, AudioBuffer& buffer) {
 
-                        }
+    CachedSound* cached = findCached(path);
 
-                    }
+    if (!cached) {
 
-                    #else
+        uint32_t hash;
 
-                    // Convert to 8-bit unsigned
+        if (!loadWavToBuffer(path, buffer, hash)) return false;
 
-                    for (size_t i = 0; i < toRead; ) {
 
-                        uint8_t val = 128;
 
-                        if (buffer.bitsPerSample == 16) {
+        cached = findCached(hash, buffer);
 
-                             // 16-bit signed -> 8-bit unsigned
+        if (!cached) {
 
-                             int16_t s = (int16_t)(tempBuf[i] | (tempBuf[i+1] << 8));
+            addCached(path, hash, buffer);
 
-                             val = (s / 256) + 128;
+            return true;
 
-                             i += 2;
+        }
 
-                        } else if (buffer.bitsPerSample == 24) {
+        releaseBuffer(buffer); // The duplicate: freed once the mixer is past it
 
-                             // 24-bit signed -> 8-bit unsigned
+        cached->addPath(path);
 
-                             val = tempBuf[i+2] ^ 0x80;
+    }
 
-                             i += 3;
 
-                        } else {
 
-                             // 8-bit unsigned (already correct)
+    cached->refs++;
 
-                             val = tempBuf[i];
+    cached->lastUse = ++cacheClock;
 
-                             i += 1;
+    releaseBuffer(buffer);
 
-                        }
+    buffer.size = cached->sound.size;
 
-                        if (outIndex < buffer.size) buffer.data[outIndex++] = val;
+    buffer.frames = cached->sound.frames;
 
-                    }
+    buffer.onsetFrames = cached->sound.onsetFrames;
 
-                    #endif
+    buffer.format = cached->sound.format;
 
-                    
+    buffer.sampleRate = cached->sound.sampleRate;
 
-                    bytesRead += toRead;
+    buffer.channels = cached->sound.channels;
 
-                    if (bytesRead % 10240 == 0) delay(1); // Yield
+    buffer.bitsPerSample = cached->sound.bitsPerSample;
 
-                }
+    buffer.ownsData = false;
 
-                
+    buffer.data = cached->sound.data;
 
-                free(tempBuf);
 
-                
 
-                #ifdef USE_I2S_AUDIO
+    Serial.print("From sound cache: "); Serial.println(path);
 
-                buffer.bitsPerSample = 16;
+    return true;
 
-                #else
+}
 
-                buffer.bitsPerSample = 8; 
 
-                #endif
 
-                
+SoundManager::CachedSound* SoundManager::findCached(const String& path) {
 
-                foundData = true;
+    for (int i = 0; i < SOUND_CACHE_SLOTS; i++) {
 
-                Serial.print("Loaded & Converted bytes: "); Serial.println(targetSize);
+        if (cache[i].sound.data && cache[i].hasPath(path)) return &cache[i];
 
-            } else {
+    }
 
-                Serial.println("Error: Malloc failed!");
+    return nullptr;
 
-            }
+}
 
-            break; // Stop after data
 
-        } else {
 
-            file.seek(file.position() + chunkSize);
+// Cached audio identical to `sound`: found by hash, then confirmed on the
 
-        }
+// stored samples (equal hashes alone could be a collision)
 
-    }
+SoundManager::CachedSound* SoundManager::findCached(uint32_t hash, const AudioBuffer& sound) {
 
-    
+    for (int i = 0; i < SOUND_CACHE_SLOTS; i++) {
 
-    file.close();
+        const AudioBuffer& other = cache[i].sound;
 
-    return foundFmt && foundData;
+        if (!other.data || cache[i].hash != hash) continue;
 
-}
+        if (other.frames != sound.frames || other.size != sound.size || other.format != sound.format) continue;
 
+        if (memcmp(other.data, sound.data, sound.size) == 0) return &cache[i];
 
+    }
 
-#ifdef USE_I2S_AUDIO
+    return nullptr;
 
-void SoundManager::playI2S(AudioBuffer* buffer) {
+}
 
-    if (!buffer || !buffer->data) return;
 
-    
 
-    // Apply Volume (Software Scaling)
+// Hands a freshly loaded sound to the cache (with one reference: buffer)
 
-    // We create a temporary buffer or scale in place?
+void SoundManager::addCached(const String& path, uint32_t hash, AudioBuffer& buffer) {
 
-    // Scaling in place modifies the original sound, which is bad if we change volume.
+    CachedSound* slot = nullptr;
 
-    // But we only have one copy in RAM.
+    for (int i = 0; i < SOUND_CACHE_SLOTS && !slot; i++) {
 
-    // Better: Scale on the fly while writing to I2S?
+        if (!cache[i].sound.data) slot = &cache[i];
 
-    // i2s_write takes a buffer.
+    }
 
-    // Let's allocate a small chunk, scale, and write.
+    if (!slot && evictOneCached()) return addCached(path, hash, buffer);
 
-    
+    if (!slot) return; // Every slot in use: the buffer keeps its own copy
 
-    size_t bytesWritten;
 
-    size_t totalBytes = buffer->size;
 
-    size_t chunkBytes = 1024; // Process in chunks
+    slot->sound = buffer;
 
-    int16_t* src = (int16_t*)buffer->data;
+    slot->hash = hash;
 
-    
+    for (String& known : slot->paths) known = String();
 
-    // Temp buffer for scaled audio
+    slot->nextPath = 0;
 
-    int16_t* tempBuf = (int16_t*)malloc(chunkBytes);
+    slot->addPath(path);
 
-    if (!tempBuf) return;
+    slot->refs = 1;
 
-    
+    slot->lastUse = ++cacheClock;
 
-    size_t processed = 0;
+    buffer.ownsData = false; // Freed by the cache
 
-    while (processed < totalBytes) {
+    evictCached(0);
+
+}
 
-        size_t remaining = totalBytes - processed;
 
-        size_t currentChunk = (remaining > chunkBytes) ? chunkBytes : remaining;
 
-        size_t samples = currentChunk / 2;
+// Drops a reference. Unreferenced sounds stay cached until evicted.
 
-        
+bool SoundManager::releaseCached(uint8_t* data) {
 
-        // Scale
+    for (int i = 0; i < SOUND_CACHE_SLOTS; i++) {
 
-        for (size_t i = 0; i < samples; i++) {
+        if (cache[i].sound.data == data && cache[i].refs > 0) {
 
-            int32_t val = src[(processed / 2) + i];
+            cache[i].refs--;
 
-            val = (val * volume) / 255;
+            evictCached(0);
 
-            tempBuf[i] = (int16_t)val;
+            return true;
 
         }
 
-        
+    }
 
-        // Write to I2S (Blocking if DMA full)
+    return false;
 
-        // Since this is called from main loop (via playDownbeat -> playI2S), it might block UI.
+}
 
-        // But for short clicks (50ms), it's fine.
 
-        // Wait! playDownbeat is called from Timer Interrupt in main loop?
 
-        // No, playDownbeat is called from main loop logic.
+// Evicts least recently used, unreferenced sounds until `needed` more
 
-        // If we block here for 50ms, the UI will freeze for 50ms. That's acceptable for a metronome click.
+// bytes fit into SOUND_CACHE_BYTES (or nothing is left to evict)
 
-        // Actually, i2s_write returns quickly if DMA buffer is large enough.
+void SoundManager::evictCached(size_t needed) {
 
-        // We set dma_buf_count=8, len=64 -> 512 samples -> ~11ms.
+    for (;;) {
 
-        // If sound is 50ms, we will block for ~40ms.
+        size_t used = 0;
 
-        // To avoid blocking, we should use a task.
+        for (int i = 0; i < SOUND_CACHE_SLOTS; i++) used += cache[i].sound.size;
 
-        // But for now, let's try direct write.
+        if (used + needed <= SOUND_CACHE_BYTES) return;
 
-        
+        if (!evictOneCached()) return;
 
-        i2s_write(I2S_NUM, tempBuf, currentChunk, &bytesWritten, portMAX_DELAY);
+    }
 
-        processed += currentChunk;
+}
 
-    }
 
-    
 
-    free(tempBuf);
+bool SoundManager::evictOneCached() {
+
+    CachedSound* victim = nullptr;
+
+    for (int i = 0; i < SOUND_CACHE_SLOTS; i++) {
+
+        if (!cache[i].sound.data || cache[i].refs > 0) continue;
+
+        if (!victim || (int32_t)(cache[i].lastUse - victim->lastUse) < 0) victim = &cache[i];
+
+    }
+
+    if (!victim) return false;
 
-    
 
-    // Write some silence to flush?
 
-    // i2s_zero_dma_buffer(I2S_NUM); // This clears the buffer, might cut off sound.
+    // Unreferenced: no AudioBuffer points here, so the mixer cannot either
 
-    // Better to write 0s.
+    free(victim->sound.data);
 
-    // int16_t silence[64] = {0};
+    *victim = CachedSound();
 
-    // i2s_write(I2S_NUM, silence, 128, &bytesWritten, portMAX_DELAY);
+    return true;
 
 }
 
-#endif
 
 
+// Stores n samples in the output format, using 32-bit writes once the
+
+// destination is word aligned
+
+static void storePcm(AudioSample* dst, const int16_t* in, size_t n) {
+
+    const size_t perWord = sizeof(uint32_t) / sizeof(AudioSample);
+
+    const uint32_t mask = (sizeof(AudioSample) == 1) ? 0xFF : 0xFFFF;
+
 
-void SoundManager::playDownbeat() {
 
-    #ifdef USE_I2S_AUDIO
+    while (n > 0 && ((uintptr_t)dst & 3)) {
 
-    playI2S(&downbeat);
+        *dst++ = OutputBackend::fromPcm16(*in++);
 
-    #else
+        n--;
 
-    if (!downbeat.data) return;
+    }
 
-    portENTER_CRITICAL(&timerMux);
+    uint32_t* words = (uint32_t*)dst;
 
-    playing = false;
+    for (; n >= perWord; n -= perWord, in += perWord) {
 
-    currentBuffer = &downbeat;
+        uint32_t word = 0;
 
-    playIndex = 0;
+        for (size_t k = 0; k < perWord; k++) {
 
-    // Update timer: 1MHz / sampleRate
+            word |= ((uint32_t)OutputBackend::fromPcm16(in[k]) & mask) << (k * 8 * sizeof(AudioSample));
 
-    if (downbeat.sampleRate > 0) {
+        }
 
-        timerAlarmWrite(timer, 1000000 / downbeat.sampleRate, true);
+        *words++ = word;
 
     }
 
-    playing = true;
+    dst = (AudioSample*)words;
 
-    timerAlarmEnable(timer); // Enable timer
+    while (n > 0) {
 
-    portEXIT_CRITICAL(&timerMux);
+        *dst++ = OutputBackend::fromPcm16(*in++);
 
-    #endif
+        n--;
+
+    }
 
 }
 
 
 
-void SoundManager::playBeat() {
+#ifdef USE_ADPCM_STORAGE
 
-    #ifdef USE_I2S_AUDIO
+static const SampleFormat storageFormat = SAMPLE_ADPCM;
 
-    playI2S(&beat);
+#else
 
-    #else
+static const SampleFormat storageFormat = SAMPLE_PCM;
 
-    if (!beat.data) return;
+#endif
 
-    portENTER_CRITICAL(&timerMux);
 
-    playing = false;
 
-    currentBuffer = &beat;
+// Bytes needed to store the given number of samples
 
-    playIndex = 0;
+static inline size_t storageBytes(size_t frames) {
 
-    if (beat.sampleRate > 0) {
+    if (storageFormat == SAMPLE_ADPCM) return Adpcm::bytesFor(frames);
 
-        timerAlarmWrite(timer, 1000000 / beat.sampleRate, true);
+    return frames * sizeof(AudioSample);
 
-    }
+}
 
-    playing = true;
 
-    timerAlarmEnable(timer); // Enable timer
 
-    portEXIT_CRITICAL(&timerMux);
+// Samples that fit into the given number of bytes
 
-    #endif
+static inline size_t storageFrames(size_t bytes) {
+
+    if (storageFormat == SAMPLE_ADPCM) return Adpcm::samplesFor(bytes);
+
+    return bytes / sizeof(AudioSample);
 
 }
 
 
 
-void SoundManager::setVolume(uint8_t vol) {
+// Receives the converted samples in order and stores them in the storage
 
-    volume = vol;
+// format. Leading silence is dropped (keeping ONSET_PREROLL_FRAMES before the
 
-}
+// first audible sample), and the level is tracked so the caller can cut the
 
+// silent tail and find the onset afterwards.
 
+class SampleWriter {
 
-void IRAM_ATTR SoundManager::handleInterrupt() {
+public:
 
-    if (!playing || !currentBuffer || !currentBuffer->data) {
+    SampleWriter(uint8_t* data, size_t capacity, Adpcm::Encoder& adpcm)
 
-        timerAlarmDisable(timer); // Stop interrupt
+        : data(data), capacity(capacity), adpcm(adpcm) {
 
-        return;
+        if (storageFormat == SAMPLE_ADPCM) adpcm.begin(data);
 
     }
 
-    
 
-    if (playIndex >= currentBuffer->size) {
 
-        playing = false;
+    bool full() const { return count >= capacity; }
 
-        dacWrite(26, 128); // Silence
 
-        timerAlarmDisable(timer); // Stop interrupt
 
-        return;
+    void writeBlock(const int16_t* in, size_t n) {
+
+        size_t i = 0;
+
+        while (!started && i < n) write(in[i++]);
+
+        if (i < n) storeBlock(in + i, n - i);
 
     }
 
-    
 
-    // Data is always 8-bit unsigned now (converted on load)
 
-    uint8_t output = currentBuffer->data[playIndex];
+    void write(int16_t val) {
 
-    
+        if (!started) {
 
-    // Advance index (skip other channels if stereo)
+            if (abs(val) < SILENCE_THRESHOLD) {
 
-    // Since we kept channels during conversion, we skip N bytes
+                preroll[skipped++ % ONSET_PREROLL_FRAMES] = val;
 
-    playIndex += currentBuffer->channels;
+                return;
 
-    
+            }
+
+            started = true;
+
+            size_t n = skipped < ONSET_PREROLL_FRAMES ? skipped : ONSET_PREROLL_FRAMES;
+
+            for (size_t i = skipped - n; i < skipped; i++) store(preroll[i % ONSET_PREROLL_FRAMES]);
 
-    // Apply Volume (Optimized)
+        }
 
-    if (volume != 255) {
+        store(val);
 
-        // Fast integer scaling: (sample * volume) >> 8
+    }
 
-        // Center at 0 for scaling: (val - 128)
 
-        int16_t sample = (int16_t)output - 128;
 
-        sample = (sample * volume) >> 8; // Bit shift is faster than division
+    void finish() {
 
-        output = (uint8_t)(sample + 128);
+        if (storageFormat == SAMPLE_ADPCM) adpcm.finish();
 
     }
 
 
 
-    dacWrite(26, output);
+    // Stored samples up to the last audible one
 
-}
+    size_t audibleFrames() const { return started ? lastAudible + 1 : 0; }
+
+
+
+    // First sample within ONSET_MAX_LEAD that reaches the onset threshold
+
+    size_t onset() const {
+
+        int32_t threshold = peak / ONSET_THRESHOLD_DIV;
+
+        size_t n = count < ONSET_MAX_LEAD ? count : ONSET_MAX_LEAD;
+
+        for (size_t i = 0; i < n; i++) {
+
+            if (abs(head[i]) >= threshold) return i;
+
+        }
+
+        return n;
 
-void SoundManager::previewSound(String filename) {
-    // Preview the 'Beat' sound of the selected set
-    String path = "/" + filename + "_Beat.wav";
-    
-    // We use a temporary buffer to avoid overwriting the main sounds until confirmed
-    AudioBuffer tempBuffer;
-    if (loadWavToBuffer(path, tempBuffer)) {
-        #ifdef USE_I2S_AUDIO
-        playI2S(&tempBuffer);
-        // We need to wait for the sound to play before freeing memory
-        // A simple delay is acceptable in the UI thread for a preview
-        delay(100); 
-        if (tempBuffer.data) free(tempBuffer.data);
-        #endif
     }
+
+
+
+private:
+
+    uint8_t* data;
+
+    size_t capacity;
+
+    Adpcm::Encoder& adpcm;
+
+
+
+    size_t count = 0;
+
+    bool started = false;
+
+    size_t skipped = 0;
+
+    size_t lastAudible = 0;
+
+    int32_t peak = 0;
+
+    int16_t preroll[ONSET_PREROLL_FRAMES];
+
+    int16_t head[ONSET_MAX_LEAD]; // Start of the stored sound, for onset()
+
+
+
+    void store(int16_t val) {
+
+        if (full()) return;
+
+        if (storageFormat == SAMPLE_ADPCM) adpcm.push(val);
+
+        else ((AudioSample*)data)[count] = OutputBackend::fromPcm16(val);
+
+
+
+        int32_t level = abs(val);
+
+        if (level > peak) peak = level;
+
+        if (level >= SILENCE_THRESHOLD) lastAudible = count;
+
+        if (count < ONSET_MAX_LEAD) head[count] = val;
+
+        count++;
+
+    }
+
+
+
+    void storeBlock(const int16_t* in, size_t n) {
+
+        if (n > capacity - count) n = capacity - count;
+
+
+
+        for (size_t i = 0; i < n; i++) {
+
+            int32_t level = abs(in[i]);
+
+            if (level > peak) peak = level;
+
+            if (level >= SILENCE_THRESHOLD) lastAudible = count + i;
+
+            if (count + i < ONSET_MAX_LEAD) head[count + i] = in[i];
+
+        }
+
+
+
+        if (storageFormat == SAMPLE_ADPCM) {
+
+            for (size_t i = 0; i < n; i++) adpcm.push(in[i]);
+
+        } else {
+
+            storePcm((AudioSample*)data + count, in, n);
+
+        }
+
+        count += n;
+
+    }
+
+};
+
+
+
+bool SoundManager::loadWavToBuffer(String path, AudioBuffer& buffer, uint32_t& hash) {
+
+    uint32_t startTime = micros();
+
+    if (!LittleFS.exists(path)) return false;
+
+    File file = LittleFS.open(path, "r");
+
+    if (!file) return false;
+
+
+
+    WavInfo wav;
+
+    WavStatus status = WavParser::parse(file, wav);
+
+
+
+    Serial.print("WAV Format: Code="); Serial.print(wav.formatCode);
+
+    Serial.print(", Chan="); Serial.print(wav.channels);
+
+    Serial.print(", Rate="); Serial.print(wav.sampleRate);
+
+    Serial.print(", Bits="); Serial.println(wav.bitsPerSample);
+
+
+
+    if (status != WAV_OK) {
+
+        Serial.print("Error: "); Serial.println(WavParser::describe(status));
+
+        file.close();
+
+        return false;
+
+    }
+
+
+
+    // FNV-1a over the format and the audio data as it is read, so files that
+
+    // only differ in metadata (or name) hash the same
+
+    hash = 2166136261u;
+
+    hash = fnv1a(hash, (const uint8_t*)&wav.channels, sizeof(wav.channels));
+
+    hash = fnv1a(hash, (const uint8_t*)&wav.sampleRate, sizeof(wav.sampleRate));
+
+    hash = fnv1a(hash, (const uint8_t*)&wav.bitsPerSample, sizeof(wav.bitsPerSample));
+
+
+
+    // Everything in RAM ends up mono at the output rate:
+
+    // stereo is downmixed and other rates are resampled while reading.
+
+    uint16_t bytesPerSample = wav.bitsPerSample / 8;
+
+    uint16_t frameBytes = wav.blockAlign;
+
+    uint32_t inFrames = wav.frames();
+
+    Pcm::Kernel convert = Pcm::pickKernel(bytesPerSample, wav.channels);
+
+
+
+    bool resample = resampler.configure(wav.sampleRate, AUDIO_SAMPLE_RATE);
+
+    uint32_t outFrames = inFrames;
+
+    if (resample) {
+
+        outFrames = (uint32_t)(((uint64_t)inFrames * AUDIO_SAMPLE_RATE + wav.sampleRate - 1) / wav.sampleRate) + RESAMPLER_TAPS;
+
+    }
+
+
+
+    // Take the old samples away from the mixer before freeing them
+
+    releaseBuffer(buffer);
+
+
+
+    uint32_t targetSize = storageBytes(outFrames);
+
+
+
+    // Make room in the sound cache, then limit size to available RAM (safety margin)
+
+    evictCached(targetSize);
+
+    size_t freeHeap = ESP.getFreeHeap();
+
+    if (targetSize > freeHeap - 40000) {
+
+        Serial.println("Error: WAV file too large for RAM!");
+
+        Serial.print("Required: "); Serial.print(targetSize);
+
+        Serial.print(", Free: "); Serial.println(freeHeap);
+
+        file.close();
+
+        return false;
+
+    }
+
+
+
+    // Converted into private memory, published to the mixer when complete
+
+    uint8_t* data = (uint8_t*)malloc(targetSize);
+
+    if (!data) {
+
+        Serial.println("Error: Malloc failed!");
+
+        file.close();
+
+        return false;
+
+    }
+
+
+
+    // Read whole frames through the preallocated read buffer and convert on the fly.
+
+    // Reads are not overlapped with conversion on another task: a flash read
+
+    // disables the cache and stalls both cores, and the kernels run from flash,
+
+    // so nothing could convert meanwhile. Conversion is also a few percent of
+
+    // the load (test/bench/test_convert reports the split per file).
+
+    SampleWriter writer(data, storageFrames(targetSize), adpcm);
+
+    size_t readSize = (WAV_READ_CHUNK / frameBytes) * frameBytes;
+
+    size_t bytesRead = 0;
+
+    int16_t converted[CONVERT_BLOCK_FRAMES];
+
+    int16_t resampled[RESAMPLER_MAX_OUTPUT * RESAMPLER_TAPS / 2];
+
+    uint32_t lastYield = millis();
+
+
+
+    file.seek(wav.dataOffset);
+
+    while (bytesRead < wav.dataSize && !writer.full()) {
+
+        size_t toRead = wav.dataSize - bytesRead;
+
+        if (toRead > readSize) toRead = readSize;
+
+        size_t got = file.read(readBuffer, toRead);
+
+        got -= got % frameBytes;
+
+        if (got == 0) break; // File shrank under us
+
+        hash = fnv1a(hash, readBuffer, got);
+
+
+
+        size_t frames = got / frameBytes;
+
+        for (size_t f = 0; f < frames && !writer.full(); f += CONVERT_BLOCK_FRAMES) {
+
+            size_t n = frames - f;
+
+            if (n > CONVERT_BLOCK_FRAMES) n = CONVERT_BLOCK_FRAMES;
+
+            convert(readBuffer + f * frameBytes, n, converted);
+
+
+
+            if (resample) {
+
+                for (size_t i = 0; i < n; i++) {
+
+                    size_t m = resampler.push(converted[i], resampled);
+
+                    writer.writeBlock(resampled, m);
+
+                }
+
+            } else {
+
+                writer.writeBlock(converted, n);
+
+            }
+
+        }
+
+
+
+        bytesRead += got;
+
+        if (millis() - lastYield >= 10) {
+
+            delay(1); // Yield
+
+            lastYield = millis();
+
+        }
+
+    }
+
+    file.close();
+
+
+
+    if (resample) {
+
+        // Filter tail
+
+        size_t n = resampler.flush(resampled);
+
+        writer.writeBlock(resampled, n);
+
+    }
+
+    writer.finish();
+
+
+
+    // Drop the silent tail and give the unused memory back
+
+    size_t frames = writer.audibleFrames();
+
+    if (frames == 0) {
+
+        Serial.println("Error: WAV file is silent!");
+
+        free(data);
+
+        return false;
+
+    }
+
+    uint8_t* shrunk = (uint8_t*)realloc(data, storageBytes(frames));
+
+    if (shrunk) data = shrunk;
+
+
+
+    buffer.size = storageBytes(frames);
+
+    buffer.frames = frames;
+
+    buffer.onsetFrames = writer.onset();
+
+    buffer.format = storageFormat;
+
+    buffer.sampleRate = AUDIO_SAMPLE_RATE;
+
+    buffer.channels = 1;
+
+    buffer.bitsPerSample = 8 * sizeof(AudioSample);
+
+    buffer.ownsData = true;
+
+    buffer.data = data;
+
+
+
+    Serial.print("Loaded & Converted bytes: "); Serial.print(buffer.size);
+
+    Serial.print(", Onset: "); Serial.print(buffer.onsetFrames);
+
+    Serial.print(", Time: "); Serial.print(micros() - startTime); Serial.println(" us");
+
+    return true;
+
+}
+
+
+
+void SoundManager::runAudio() {
+
+    for (;;) {
+
+        int64_t start = esp_timer_get_time();
+
+        processCommands();
+
+        renderBlock(outBlock, AUDIO_BLOCK_FRAMES);
+
+        returnRetired();
+
+        releaseBeatEvents();
+
+        blocksRendered++;
+
+        TaskMonitor::busy(TASK_AUDIO, (uint32_t)(esp_timer_get_time() - start)); // Not the wait in write()
+
+        OutputBackend::write(outBlock, AUDIO_BLOCK_FRAMES);
+
+    }
+
+}
+
+
+
+void SoundManager::processCommands() {
+
+    AudioCommand cmd;
+
+    while (commands.pop(cmd)) handleCommand(cmd);
+
+    while (loadedSounds.pop(cmd)) handleCommand(cmd);
+
+}
+
+
+
+void SoundManager::handleCommand(const AudioCommand& cmd) {
+
+    switch (cmd.type) {
+
+        case CMD_PLAY:
+
+            mixer.trigger(cmd.buffer);
+
+            break;
+
+        case CMD_PLAY_SOUND:
+
+            mixer.trigger(activeSound[cmd.arg0], Gain::fromLevel(soundLevel[cmd.arg0]));
+
+            break;
+
+        case CMD_SWAP_SOUND:
+
+            pendingSound[cmd.arg0] = cmd.buffer;
+
+            if (!scheduler.isRunning()) applyPendingSwaps();
+
+            break;
+
+        case CMD_START:
+
+            // First beat one lead later, so even it can start early by its onset
+
+            scheduler.start(samplePosition + ONSET_MAX_LEAD, cmd.arg0, cmd.arg1);
+
+            pendingBeatCount = 0; // Beats of a previous run are no news to the UI
+
+            retireTimeline(playingTimeline);
+
+            retireTimeline(queuedTimeline);
+
+            playingTimeline = queuedTimeline = nullptr;
+
+            break;
+
+        case CMD_START_PROGRAM:
+
+            retireTimeline(playingTimeline);
+
+            retireTimeline(queuedTimeline);
+
+            playingTimeline = cmd.timeline;
+
+            queuedTimeline = nullptr;
+
+            scheduler.start(samplePosition + ONSET_MAX_LEAD, playingTimeline, cmd.arg0);
+
+            pendingBeatCount = 0;
+
+            break;
+
+        case CMD_UPDATE_PROGRAM:
+
+            retireTimeline(queuedTimeline); // Edited again before it got to play
+
+            queuedTimeline = nullptr;
+
+            if ((scheduler.isRunning() || scheduler.isPaused()) && scheduler.timelinePlaying()) {
+
+                queuedTimeline = cmd.timeline;
+
+                scheduler.replaceTimeline(queuedTimeline);
+
+            } else {
+
+                retireTimeline(cmd.timeline);
+
+            }
+
+            break;
+
+        case CMD_SET_LOOP:
+
+            scheduler.setLoop(cmd.arg0);
+
+            break;
+
+        case CMD_PAUSE:
+
+            scheduler.pause(samplePosition);
+
+            break;
+
+        case CMD_RESUME:
+
+            // Same distance to the next beat as at the pause (see renderBlock)
+
+            scheduler.resume(samplePosition);
+
+            break;
+
+        case CMD_JUMP: {
+
+            // A queued edit takes over on the same downbeat as the jump
+
+            const Timeline* target = (queuedTimeline && !scheduler.isPaused()) ? queuedTimeline : scheduler.timelinePlaying();
+
+            if (target) scheduler.jumpTo(target->barOf(cmd.arg0, cmd.arg1));
+
+            break;
+
+        }
+
+        case CMD_SEEK: {
+
+            // Bar at that time in the program, found by binary search (Timeline::barAt)
+
+            const Timeline* target = (queuedTimeline && !scheduler.isPaused()) ? queuedTimeline : scheduler.timelinePlaying();
+
+            if (!target) break;
+
+            int64_t position = (int64_t)(scheduler.nextOnset() - scheduler.programStart()) + cmd.arg0;
+
+            scheduler.jumpTo(target->barAt(position > 0 ? (uint32_t)position : 0));
+
+            break;
+
+        }
+
+        case CMD_STOP:
+
+            scheduler.stop();
+
+            applyPendingSwaps();
+
+            break;
+
+        case CMD_SET_TEMPO:
+
+            scheduler.setTempo(cmd.arg0, cmd.arg1);
+
+            break;
+
+        case CMD_RESTART_BAR:
+
+            scheduler.restartBar();
+
+            break;
+
+    }
+
+}
+
+
+
+// Makes a loaded sound the one beats play. The old one keeps sounding in
+
+// whatever voices already play it and goes back to the loader afterwards.
+
+void SoundManager::swapSound(SoundType type) {
+
+    AudioBuffer* incoming = pendingSound[type];
+
+    if (!incoming) return;
+
+    pendingSound[type] = nullptr;
+
+    retiringSound[type] = activeSound[type]; // Free: only two buffers per type
+
+    activeSound[type] = incoming;
+
+}
+
+
+
+void SoundManager::applyPendingSwaps() {
+
+    swapSound(SOUND_DOWNBEAT);
+
+    swapSound(SOUND_BEAT);
+
+}
+
+
+
+// Hands swapped-out sounds back to the loader once no voice reads them
+
+void SoundManager::returnRetired() {
+
+    for (int type = 0; type < 2; type++) {
+
+        AudioBuffer* old = retiringSound[type];
+
+        if (old && !mixer.isPlaying(old) && releasedSounds.push(old)) retiringSound[type] = nullptr;
+
+    }
+
+}
+
+
+
+void SoundManager::renderBlock(int16_t* out, size_t frames) {
+
+    memset(mixBlock, 0, frames * sizeof(int32_t));
+
+
+
+    size_t pos = 0;
+
+    while (pos < frames) {
+
+        // Mix up to the next scheduled beat, then start it on its exact sample.
+
+        // Sounds start early by their onset offset, so the audible transient
+
+        // (not the first stored sample) lands on the beat for every set.
+
+        // A beat closer than its onset (right after a resume) starts at once.
+
+        size_t run = frames - pos;
+
+        if (scheduler.isRunning()) {
+
+            uint64_t now = samplePosition + pos;
+
+            const AudioBuffer& next = *activeSound[scheduler.accented() ? SOUND_DOWNBEAT : SOUND_BEAT];
+
+            uint64_t due = scheduler.nextOnset();
+
+            if (due <= now + next.onsetFrames) {
+
+                fireScheduledBeat();
+
+                continue;
+
+            }
+
+            uint64_t start = due - next.onsetFrames;
+
+            if (start - now < run) run = (size_t)(start - now);
+
+        }
+
+        mixer.mix(mixBlock + pos, run);
+
+        pos += run;
+
+    }
+
+
+
+    if (outputChainEnabled) {
+
+        if (!outputChainActive) {
+
+            outputChain.reset(); // Do not replay what was in the delay line
+
+            outputChainActive = true;
+
+        }
+
+        uint32_t start = ESP.getCycleCount();
+
+        outputChain.process(mixBlock, frames);
+
+        uint32_t cycles = ESP.getCycleCount() - start;
+
+        if (cycles > outputChainCycles) outputChainCycles = cycles;
+
+    } else {
+
+        outputChainActive = false;
+
+    }
+
+
+
+    // Volume (ramped across the block) and saturation of the summed voices
+
+    masterGain.setTarget(Gain::fromLevel(volume));
+
+    masterGain.apply(mixBlock, out, frames);
+
+    samplePosition += frames;
+
+}
+
+
+
+void SoundManager::fireScheduledBeat() {
+
+    SoundType type = scheduler.accented() ? SOUND_DOWNBEAT : SOUND_BEAT;
+
+    mixer.trigger(activeSound[type], Gain::fromLevel(soundLevel[type]));
+
+    PendingBeat beat;
+
+    beat.at = scheduler.nextOnset();
+
+    beat.event.beatInBar = scheduler.beatInBar();
+
+    const TimelineBar* bar = scheduler.currentBar();
+
+    beat.event.step = bar ? bar->step : 0;
+
+    beat.event.barInStep = bar ? bar->barInStep : 0;
+
+    scheduler.advance();
+
+    beat.event.programEnd = !scheduler.isRunning(); // Only a program stops by itself
+
+    if (pendingBeatCount < 8) { // A beat is far longer than the output queue, never full
+
+        pendingBeats[(pendingBeatHead + pendingBeatCount) & 7] = beat;
+
+        pendingBeatCount++;
+
+    }
+
+    // The bar just started may be the first of an edited program
+
+    if (queuedTimeline && scheduler.timelinePlaying() == queuedTimeline) {
+
+        retireTimeline(playingTimeline);
+
+        playingTimeline = queuedTimeline;
+
+        queuedTimeline = nullptr;
+
+    }
+
+
+
+    // Beat boundary: sounds loaded meanwhile take over from the next beat on
+
+    applyPendingSwaps();
+
+}
+
+
+
+// Passes beats on to the UI once they come out of the output queue
+
+void SoundManager::releaseBeatEvents() {
+
+    while (pendingBeatCount > 0) {
+
+        const PendingBeat& beat = pendingBeats[pendingBeatHead];
+
+        if (beat.at + AUDIO_OUTPUT_LATENCY > samplePosition) break;
+
+        beatEvents.push(beat.event); // Dropped if the UI is not keeping up
+
+        pendingBeatHead = (pendingBeatHead + 1) & 7;
+
+        pendingBeatCount--;
+
+    }
+
+}
+
+
+
+// Hands a program the scheduler no longer needs back to the UI to delete.
+
+// The UI empties the queue before every program command, so it never fills.
+
+void SoundManager::retireTimeline(Timeline* timeline) {
+
+    if (timeline) releasedTimelines.push(timeline);
+
+}
+
+
+
+bool SoundManager::postCommand(AudioCommandType type, int32_t arg0, int32_t arg1, AudioBuffer* buffer, Timeline* timeline) {
+
+    AudioCommand cmd = {type, arg0, arg1, buffer, timeline};
+
+    if (!commands.push(cmd)) {
+
+        Serial.println("Audio command queue full!");
+
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+
+// Takes the sound away from the mixer, then frees or unreferences its memory
+
+void SoundManager::releaseBuffer(AudioBuffer& buffer) {
+
+    bool ownedOld = buffer.ownsData;
+
+    uint8_t* oldData = retireBufferData(buffer);
+
+    if (!oldData) return;
+
+    if (!releaseCached(oldData) && ownedOld) free(oldData);
+
+}
+
+
+
+uint8_t* SoundManager::retireBufferData(AudioBuffer& buffer) {
+
+    uint8_t* old = buffer.data;
+
+    buffer.data = nullptr;
+
+    if (!old || !audioTaskHandle) return old;
+
+
+
+    // The mixer reads buffer.data once per block. After two more blocks it can
+
+    // no longer hold the old pointer. This waits at most ~3 ms.
+
+    uint32_t start = blocksRendered;
+
+    while (blocksRendered - start < 2) vTaskDelay(1);
+
+    return old;
+
+}
+
+
+
+void SoundManager::startMetronome(int bpm, int beatsPerBar) {
+
+    BeatEvent stale;
+
+    while (beatEvents.pop(stale)) {} // Forget beats of a previous run
+
+    collectTimelines();
+
+    postCommand(CMD_START, bpm, beatsPerBar);
+
+}
+
+
+
+bool SoundManager::startProgram(const std::vector<SequenceStep>& sequence, bool loop) {
+
+    collectTimelines();
+
+    Timeline* timeline = new Timeline();
+
+    if (!timeline->compile(sequence, AUDIO_SAMPLE_RATE)) {
+
+        delete timeline;
+
+        return false;
+
+    }
+
+    BeatEvent stale;
+
+    while (beatEvents.pop(stale)) {}
+
+    if (!postCommand(CMD_START_PROGRAM, loop, 0, nullptr, timeline)) {
+
+        delete timeline;
+
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+
+bool SoundManager::updateProgram(const std::vector<SequenceStep>& sequence) {
+
+    collectTimelines();
+
+    Timeline* timeline = new Timeline();
+
+    if (!timeline->compile(sequence, AUDIO_SAMPLE_RATE)) {
+
+        delete timeline; // Keeps playing the previous version
+
+        return false;
+
+    }
+
+    if (!postCommand(CMD_UPDATE_PROGRAM, 0, 0, nullptr, timeline)) {
+
+        delete timeline;
+
+        return false;
+
+    }
+
+    return true;
+
+}
+
+
+
+void SoundManager::setProgramLoop(bool loop) {
+
+    postCommand(CMD_SET_LOOP, loop);
+
+}
+
+
+
+// Deletes the programs the mixer task is done with
+
+void SoundManager::collectTimelines() {
+
+    Timeline* timeline;
+
+    while (releasedTimelines.pop(timeline)) delete timeline;
+
+}
+
+
+
+void SoundManager::stopMetronome() {
+
+    postCommand(CMD_STOP);
+
+}
+
+
+
+void SoundManager::pauseMetronome() {
+
+    postCommand(CMD_PAUSE);
+
+}
+
+
+
+void SoundManager::resumeMetronome() {
+
+    postCommand(CMD_RESUME);
+
+}
+
+
+
+void SoundManager::jumpTo(int step, int barInStep) {
+
+    postCommand(CMD_JUMP, step, barInStep);
+
+}
+
+
+
+void SoundManager::seekBy(int seconds) {
+
+    postCommand(CMD_SEEK, seconds * AUDIO_SAMPLE_RATE);
+
+}
+
+
+
+void SoundManager::setTempo(int bpm, int beatsPerBar) {
+
+    postCommand(CMD_SET_TEMPO, bpm, beatsPerBar);
+
+}
+
+
+
+void SoundManager::restartBar() {
+
+    postCommand(CMD_RESTART_BAR);
+
+}
+
+
+
+bool SoundManager::pollBeat(BeatEvent& beat) {
+
+    return beatEvents.pop(beat);
+
+}
+
+
+
+void SoundManager::playDownbeat() {
+
+    postCommand(CMD_PLAY_SOUND, SOUND_DOWNBEAT);
+
+}
+
+
+
+void SoundManager::playBeat() {
+
+    postCommand(CMD_PLAY_SOUND, SOUND_BEAT);
+
+}
+
+
+
+void SoundManager::setVolume(uint8_t vol) {
+
+    volume = vol;
+
+}
+
+
+
+void SoundManager::setLevel(SoundType type, uint8_t level) {
+
+    soundLevel[type] = level;
+
+    prefs.putUChar(type == SOUND_DOWNBEAT ? "levelDownbeat" : "levelBeat", level);
+
+}
+
+
+
+void SoundManager::setOutputChain(bool enabled) {
+
+    outputChainEnabled = enabled;
+
+    prefs.putBool("outputChain", enabled);
+
+}
+
+
+
+uint32_t SoundManager::takeOutputChainCycles() {
+
+    uint32_t cycles = outputChainCycles;
+
+    outputChainCycles = 0; // A block finishing in between is lost, fine for a peak meter
+
+    return cycles;
+
+}
+
+
+
+void SoundManager::previewSound(String filename) {
+
+    // Preview the 'Beat' sound of the selected set
+
+    String path = "/" + filename + "_Beat.wav";
+
+
+
+    // Separate buffer so the main sounds are not overwritten until confirmed.
+
+    // Bank sounds play straight from flash, anything else goes through the
+
+    // sound cache: previewing a set again (or selecting it) reads no flash.
+
+    // Loaded and played by the loader task, so the list stays responsive.
+
+    requestLoad(LOAD_PREVIEW, path);
+
+}
+
+
+
+bool SoundManager::requestLoad(LoadTarget target, const String& path) {
+
+    if (path.length() >= LOADER_PATH_LEN) {
+
+        Serial.print("Path too long: "); Serial.println(path);
+
+        return false;
+
+    }
+
+
+
+    LoadRequest request;
+
+    request.target = target;
+
+    strcpy(request.path, path.c_str());
+
+    if (!loadRequests.push(request)) {
+
+        Serial.println("Load queue full!");
+
+        return false;
+
+    }
+
+    xTaskNotifyGive(loaderTaskHandle);
+
+    return true;
+
+}
+
+
+
+void SoundManager::runLoader() {
+
+    for (;;) {
+
+        // Woken by a request, otherwise looks for released sounds every 10 ms
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+
+        collectReleased();
+
+
+
+        // Only the newest request per target matters (e.g. scrolling the list)
+
+        LoadRequest latest[3];
+
+        bool wanted[3] = {false, false, false};
+
+        LoadRequest request;
+
+        while (loadRequests.pop(request)) {
+
+            latest[request.target] = request;
+
+            wanted[request.target] = true;
+
+        }
+
+        int64_t start = esp_timer_get_time();
+
+        for (int target = 0; target < 3; target++) {
+
+            if (wanted[target]) handleLoad(latest[target]);
+
+        }
+
+        TaskMonitor::busy(TASK_LOADER, (uint32_t)(esp_timer_get_time() - start));
+
+    }
+
+}
+
+
+
+void SoundManager::handleLoad(const LoadRequest& request) {
+
+    String path = request.path;
+
+
+
+    if (request.target == LOAD_PREVIEW) {
+
+        // Reloaded in place: a preview is not on the beat and may be cut short
+
+        if (loadInto(path, previewBuffer)) {
+
+            AudioCommand cmd = {CMD_PLAY, 0, 0, &previewBuffer, nullptr};
+
+            loadedSounds.push(cmd);
+
+        }
+
+        return;
+
+    }
+
+
+
+    SoundType type = (SoundType)request.target;
+
+    if (path == loadedPath[type]) return; // Already playing or about to
+
+
+
+    // Never the buffer the mixer plays: it keeps ticking with the old sound
+
+    AudioBuffer* buffer = takeSpare(type);
+
+    if (!loadInto(path, *buffer)) {
+
+        Serial.print("Failed to load "); Serial.println(path);
+
+        size_t slot = buffer - &sounds[0][0];
+
+        spareSound[slot / 2][slot % 2] = true;
+
+        return;
+
+    }
+
+    loadedPath[type] = path;
+
+
+
+    AudioCommand cmd = {CMD_SWAP_SOUND, type, 0, buffer, nullptr};
+
+    while (!loadedSounds.push(cmd)) vTaskDelay(1);
+
+}
+
+
+
+// A buffer of this type that the mixer does not use. Waits while the last
+
+// loaded one is still queued for a beat or the old one still sounds.
+
+AudioBuffer* SoundManager::takeSpare(SoundType type) {
+
+    for (;;) {
+
+        for (int i = 0; i < 2; i++) {
+
+            if (spareSound[type][i]) {
+
+                spareSound[type][i] = false;
+
+                return &sounds[type][i];
+
+            }
+
+        }
+
+        vTaskDelay(1);
+
+        collectReleased();
+
+    }
+
+}
+
+
+
+// Frees (or unreferences) sounds the mixer gave back, making them spare
+
+void SoundManager::collectReleased() {
+
+    AudioBuffer* buffer;
+
+    while (releasedSounds.pop(buffer)) {
+
+        bool owned = buffer->ownsData;
+
+        uint8_t* data = buffer->data;
+
+        buffer->data = nullptr; // Not read by the mixer anymore, no need to retire
+
+        if (data && !releaseCached(data) && owned) free(data);
+
+
+
+        size_t slot = buffer - &sounds[0][0];
+
+        spareSound[slot / 2][slot % 2] = true;
+
+    }
+
 }
@@ -6,33 +6,168 @@
 #include <FS.h>
 #include <LittleFS.h>
 #include <Preferences.h>
-#include <driver/i2s.h>
+#include "AudioBackend.h"
+#include "BeatScheduler.h"
+#include "SpscQueue.h"
+#include "VoiceMixer.h"
+#include "GainStage.h"
+#include "OutputChain.h"
+#include "Resampler.h"
+#include "SampleBank.h"
+#include "BuiltinSounds.h"
+#include "Adpcm.h"
+#include "WavParser.h"
 
 // --- CONFIG ---
 #define USE_I2S_AUDIO  // Comment out to use internal DAC (Pin 26)
+// #define USE_NULL_AUDIO // No output device at all (see NullBackend)
+// #define USE_DAC_TIMER_AUDIO // Internal DAC from a timer ISR, for comparison (see DacTimerBackend)
+#define USE_OUTPUT_CHAIN // Speaker EQ + limiter until switched off (tap the volume bar, saved; see OutputChain.h)
 // --------------
 
-#ifdef USE_I2S_AUDIO
-  // GPIO 21 is LCD Backlight (Causes flickering!)
-  // GPIO 35 is Input Only (Cannot be BCLK!)
-  // Recommended CYD I2S Pins:
-  #define I2S_BCLK  27 // P3/CN1 Header (Side)
-  #define I2S_LRCK  1  // TX Pin on UART/P1 Header (Connector Pin!)
-  #define I2S_DOUT  3  // RX Pin on UART/P1 Header (Connector Pin!)
-  #define I2S_NUM   I2S_NUM_0
+// GPIO 21 is LCD Backlight (Causes flickering!)
+// GPIO 35 is Input Only (Cannot be BCLK!)
+// Recommended CYD I2S Pins:
+#define I2S_BCLK  27 // P3/CN1 Header (Side)
+#define I2S_LRCK  1  // TX Pin on UART/P1 Header (Connector Pin!)
+#define I2S_DOUT  3  // RX Pin on UART/P1 Header (Connector Pin!)
+#define I2S_NUM   I2S_NUM_0 // Also drives the internal DAC (built-in DAC mode is I2S0 only)
+
+// Output backend, fixed at compile time
+#if defined(USE_NULL_AUDIO)
+typedef NullBackend OutputBackend;
+#elif defined(USE_DAC_TIMER_AUDIO)
+typedef DacTimerBackend OutputBackend;
+#elif defined(USE_I2S_AUDIO) && !defined(USE_DAC_AUDIO) // -DUSE_DAC_AUDIO picks the DAC from the build flags
+typedef I2sBackend OutputBackend;
+#else
+typedef DacBackend OutputBackend;
 #endif
 
+// Sample format of every loaded sound (16-bit signed for I2S, 8-bit unsigned for DAC)
+typedef OutputBackend::Sample AudioSample;
+
+// Samples rendered per mixer block
+#define AUDIO_BLOCK_FRAMES 64
+
+// Longest the flash can keep the caches off: one 4 KB sector erase. The CYD's
+// ESP32-WROOM-32 carries a 4 MB SPI NOR flash of the W25Q32JV class, whose
+// datasheet gives 45 ms typical and 400 ms maximum for it.
+#define FLASH_ERASE_MAX_MS 400
+
+// Output DMA queue. While flash is written or erased (saving a program or a
+// setting) the cache is off and the other core parked, so the mixer stalls
+// with every other task: it runs from flash and reads the built-in and bank
+// samples from there too. The DMA keeps playing what is queued, so the queue
+// holds FLASH_ERASE_MAX_MS plus the buffer playing when the erase starts:
+// 36 buffers of 512 frames, 418 ms (36 KB for I2S, 72 KB for the DAC, which
+// sends both slots). Start, stop, tempo and volume changes are heard that
+// much later. Beat events reach the UI delayed by the same amount, in step
+// with what is heard. test/embedded/test_flash_stress checks it on the board.
+#define AUDIO_DMA_FRAMES 512 // Per DMA buffer (the driver takes at most 4092 bytes)
+#define AUDIO_DMA_BUFFERS ((FLASH_ERASE_MAX_MS * AUDIO_SAMPLE_RATE / 1000 + AUDIO_DMA_FRAMES - 1) / AUDIO_DMA_FRAMES + 1)
+#define AUDIO_OUTPUT_LATENCY (AUDIO_DMA_BUFFERS * AUDIO_DMA_FRAMES) // Frames
+
+// Mixer task placement (Arduino loop() runs on core 1)
+#define AUDIO_TASK_CORE 0
+#define AUDIO_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define AUDIO_TASK_STACK 4096
+
+// Sound loader task (reads and converts WAVs while the metronome keeps playing)
+#define LOADER_TASK_CORE 0     // Background work stays off the UI core
+#define LOADER_TASK_PRIORITY 1 // Below the mixer and loop()
+#define LOADER_TASK_STACK 6144 // SampleWriter and conversion blocks live here
+#define LOADER_PATH_LEN 64
+
+// Preallocated memory (no heap use per click)
+#define WAV_READ_CHUNK 2048       // Whole flash pages per LittleFS read
+#define CONVERT_BLOCK_FRAMES 128  // Converted at a time (on the loading task's stack)
+
+// Converted sounds kept in RAM (least recently used ones are evicted first)
+#define SOUND_CACHE_SLOTS 8
+#define SOUND_CACHE_BYTES (96 * 1024) // Total budget; sounds in use are never evicted
+#define SOUND_CACHE_PATHS 4           // Paths remembered per cached sound (files with the same audio)
+
+#define SOUND_INDEX_PATH "/sounds.idx" // Cached list of the LittleFS sound sets
+
+// Trimming and onset alignment of loaded sounds
+#define SILENCE_THRESHOLD 64      // Quieter samples count as silence (~-54 dBFS)
+#define ONSET_PREROLL_FRAMES 32   // Kept before the first audible sample
+#define ONSET_THRESHOLD_DIV 8     // Onset = first sample reaching peak / 8 (-18 dB)
+#define ONSET_MAX_LEAD 256        // Longest onset delay compensated (~5.8 ms)
+
+// Keep sounds loaded into RAM 4:1 compressed (IMA-ADPCM), decoded while mixing.
+// Sample bank sounds stay PCM (they cost no RAM).
+// #define USE_ADPCM_STORAGE
+
 enum SoundType {
     SOUND_DOWNBEAT,
     SOUND_BEAT
 };
 
+enum SampleFormat {
+    SAMPLE_PCM,   // AudioSample values
+    SAMPLE_ADPCM, // Adpcm blocks, decoded to 16-bit
+    SAMPLE_SYNTH  // data is a SynthPreset (in flash), rendered while mixing
+};
+
 struct AudioBuffer {
-    uint8_t* data = nullptr; // Stores 16-bit signed samples (cast to int16_t*) if I2S, else 8-bit unsigned
+    uint8_t* data = nullptr; // Stores samples in `format` (PCM: cast to AudioSample*)
     size_t size = 0;         // Size in bytes
-    uint32_t sampleRate = 44100;
-    uint16_t channels = 1;
-    uint16_t bitsPerSample = 16; // 16 for I2S, 8 for DAC
+    size_t frames = 0;       // Samples, whatever the format
+    uint32_t onsetFrames = 0; // Start to perceived onset, <= ONSET_MAX_LEAD
+    SampleFormat format = SAMPLE_PCM;
+    uint32_t sampleRate = 44100; // Always AUDIO_SAMPLE_RATE once loaded
+    uint16_t channels = 1;       // Always mono once loaded
+    uint16_t bitsPerSample = 16; // 8 * sizeof(AudioSample) once loaded
+    bool ownsData = true;        // false if data lives in the sample bank or the sound cache
+    bool accent = false;         // SAMPLE_SYNTH: accented variant (downbeats)
+};
+
+// Requests to the mixer task
+enum AudioCommandType {
+    CMD_PLAY,          // buffer
+    CMD_PLAY_SOUND,    // arg0 = SoundType (the sound currently in use)
+    CMD_SWAP_SOUND,    // arg0 = SoundType, buffer = newly loaded sound (from the loader)
+    CMD_START,         // arg0 = bpm, arg1 = beatsPerBar
+    CMD_STOP,
+    CMD_SET_TEMPO,     // arg0 = bpm, arg1 = beatsPerBar
+    CMD_RESTART_BAR,
+    CMD_START_PROGRAM, // timeline (now owned by the mixer), arg0 = loop
+    CMD_UPDATE_PROGRAM, // timeline: replaces the playing one from the next bar on
+    CMD_SET_LOOP,      // arg0 = loop
+    CMD_PAUSE,
+    CMD_RESUME,
+    CMD_JUMP,          // arg0 = step, arg1 = bar in step (program playback)
+    CMD_SEEK           // arg0 = samples from the next beat (negative: back)
+};
+
+struct AudioCommand {
+    AudioCommandType type;
+    int32_t arg0;
+    int32_t arg1;
+    AudioBuffer* buffer;
+    Timeline* timeline;
+};
+
+// A beat that was heard, reported to the UI
+struct BeatEvent {
+    uint8_t beatInBar;
+    bool programEnd;    // Last beat of a program played once: playback has stopped
+    uint16_t step;      // Program playback: SequenceStep of the beat
+    uint16_t barInStep; // ... and its bar within that step
+};
+
+// Requests from the UI to the loader task
+enum LoadTarget {
+    LOAD_DOWNBEAT = SOUND_DOWNBEAT,
+    LOAD_BEAT = SOUND_BEAT,
+    LOAD_PREVIEW
+};
+
+struct LoadRequest {
+    uint8_t target; // LoadTarget
+    char path[LOADER_PATH_LEN];
 };
 
 class SoundManager {
@@ -40,41 +175,186 @@ public:
     SoundManager();
     bool begin();
     std::vector<String> listWavs();
+
+    // Loading runs on the loader task: these return right away and the new
+    // sound replaces the old one at the next beat (or at once when stopped).
+    // Until then the previous sound keeps playing.
     bool selectSound(SoundType type, String filename);
     bool loadSound(SoundType type, String fullPath);
     void playDownbeat();
     void playBeat();
     void previewSound(String filename);
+
+    // Beat scheduling (timed on the output sample clock).
+    // All of these only post to the mixer task and return immediately.
+    void startMetronome(int bpm, int beatsPerBar);
+    void stopMetronome();
+    void setTempo(int bpm, int beatsPerBar);
+    void restartBar();
+    bool pollBeat(BeatEvent& beat); // Next beat that was played, in order
+
+    // Programs are compiled into a Timeline here, the mixer task then walks it
+    // on its own. false: nothing to play (or too long, see TIMELINE_MAX_BARS).
+    bool startProgram(const std::vector<SequenceStep>& sequence, bool loop);
+    bool updateProgram(const std::vector<SequenceStep>& sequence); // Edited while playing
+    void setProgramLoop(bool loop);
+
+    // Transport while a program plays. A jump lands on the next downbeat
+    // (on the resuming one when paused); resume keeps the beat phase.
+    void pauseMetronome();
+    void resumeMetronome();
+    void jumpTo(int step, int barInStep = 0);
+    void seekBy(int seconds); // To the bar playing that far from now
     
-    void setVolume(uint8_t vol);
-    bool areSoundsLoaded() { return downbeat.data != nullptr && beat.data != nullptr; }
+    void setVolume(uint8_t vol);              // Master level, 0-255 (see GainStage.h)
+    void setLevel(SoundType type, uint8_t level); // Per-role level, applied from the next click (saved)
+    uint8_t getLevel(SoundType type) { return soundLevel[type]; }
+    void setOutputChain(bool enabled); // Saved, USE_OUTPUT_CHAIN is only the default
+    bool getOutputChain() { return outputChainEnabled; }
+    uint32_t takeOutputChainCycles(); // Most CPU cycles one block took since the last call
+    uint32_t getUnderruns() { return OutputBackend::underruns(); } // Output ran dry (glitch) since boot
+    bool areSoundsLoaded() { return activeSound[SOUND_DOWNBEAT]->data != nullptr && activeSound[SOUND_BEAT]->data != nullptr; }
     
     String getDownbeatPath() { return currentDownbeatPath; }
     String getBeatPath() { return currentBeatPath; }
 
-    // Called by timer interrupt (DAC Mode only)
-    void IRAM_ATTR handleInterrupt();
+
 
 private:
     Preferences prefs;
-    AudioBuffer downbeat;
-    AudioBuffer beat;
+    AudioBuffer sounds[2][2]; // [SoundType]: the one in use and one to load into
+    AudioBuffer previewBuffer;
     
     String currentDownbeatPath;
     String currentBeatPath;
 
-    uint8_t volume = 255; // 0-255
-    
-    AudioBuffer* currentBuffer = nullptr;
-    volatile size_t playIndex = 0;
-    volatile bool playing = false;
+    volatile uint8_t volume = 255; // 0-255
+    volatile uint8_t soundLevel[2] = {255, 255}; // [SoundType]
+
+    // --- Mixer task state (only touched by the mixer task) ---
+    VoiceMixer mixer;
+    int32_t mixBlock[AUDIO_BLOCK_FRAMES];
+    Gain::Ramp masterGain;
+    OutputChain outputChain;
+    bool outputChainActive = false;
+
+    BeatScheduler scheduler;
+    uint64_t samplePosition = 0; // Samples rendered to the output so far
+    alignas(4) int16_t outBlock[AUDIO_BLOCK_FRAMES]; // Written in sample pairs
+
+    // Beats rendered but still queued for output, released to the UI once heard
+    struct PendingBeat {
+        uint64_t at; // Sample position of the beat
+        BeatEvent event;
+    };
+    PendingBeat pendingBeats[8];
+    uint8_t pendingBeatHead = 0;
+    uint8_t pendingBeatCount = 0;
+
+    AudioBuffer* pendingSound[2] = {nullptr, nullptr}; // Loaded, swapped in at the next beat
+    AudioBuffer* retiringSound[2] = {nullptr, nullptr}; // Swapped out, voices may still play it
+    Timeline* playingTimeline = nullptr; // Program the scheduler plays (or last played)
+    Timeline* queuedTimeline = nullptr;  // Edited program, taken over at the next bar
+
+    // --- Loader task state (only touched by the loader task once running) ---
+    bool spareSound[2][2] = {{false, true}, {false, true}}; // Free to load into
+    String loadedPath[2]; // Last sound loaded per SoundType (in use or about to be)
+
+    // --- Shared between UI and mixer task ---
+    TaskHandle_t audioTaskHandle = nullptr;
+    volatile uint32_t blocksRendered = 0;
+#ifdef USE_OUTPUT_CHAIN
+    volatile bool outputChainEnabled = true;
+#else
+    volatile bool outputChainEnabled = false;
+#endif
+    volatile uint32_t outputChainCycles = 0;
+    SpscQueue<AudioCommand, 16> commands; // UI -> mixer
+    SpscQueue<BeatEvent, 16> beatEvents;  // Mixer -> UI
+    SpscQueue<Timeline*, 16> releasedTimelines; // Mixer -> UI (deleted there)
+    AudioBuffer* volatile activeSound[2] = {&sounds[0][0], &sounds[1][0]}; // Written by the mixer
+
+    TaskHandle_t loaderTaskHandle = nullptr;
+    SpscQueue<LoadRequest, 8> loadRequests;     // UI -> loader
+    SpscQueue<AudioCommand, 8> loadedSounds;    // Loader -> mixer (swaps, previews)
+    SpscQueue<AudioBuffer*, 8> releasedSounds;  // Mixer -> loader (no longer played)
+
+
     
-    bool loadWavToBuffer(String path, AudioBuffer& buffer);
-    bool isValidWav(String path);
+    SampleBank bank; // Preconverted sets in flash, preferred over LittleFS
+
+    // Heap sounds, reference counted, found by path or by a hash of their audio
+    struct CachedSound {
+        AudioBuffer sound; // data == nullptr: free slot
+        uint32_t hash = 0;
+        String paths[SOUND_CACHE_PATHS]; // Files with this audio ("" = unused)
+        uint8_t nextPath = 0;            // Replaced next once all are taken
+        uint8_t refs = 0;  // AudioBuffers using it
+        uint32_t lastUse = 0;
+
+        bool hasPath(const String& path) const {
+            for (const String& known : paths) {
+                if (known == path) return true;
+            }
+            return false;
+        }
+
+        void addPath(const String& path) {
+            for (String& known : paths) {
+                if (known.length() == 0) { known = path; return; }
+            }
+            paths[nextPath] = path; // The oldest one
+            nextPath = (nextPath + 1) % SOUND_CACHE_PATHS;
+        }
+    };
+    CachedSound cache[SOUND_CACHE_SLOTS];
+    uint32_t cacheClock = 0;
+
+    alignas(4) uint8_t readBuffer[WAV_READ_CHUNK];
+    Resampler resampler;
+    Adpcm::Encoder adpcm; // Holds one block while encoding (USE_ADPCM_STORAGE)
     
-    #ifdef USE_I2S_AUDIO
-    void playI2S(AudioBuffer* buffer);
-    #endif
+    bool loadWavToBuffer(String path, AudioBuffer& buffer, uint32_t& hash);
+    bool loadBuiltin(const String& path, AudioBuffer& buffer);
+    bool loadSynth(const String& path, AudioBuffer& buffer);
+    bool loadFromBank(String path, AudioBuffer& buffer);
+    bool loadStored(String path, AudioBuffer& buffer);
+    CachedSound* findCached(const String& path);
+    CachedSound* findCached(uint32_t hash, const AudioBuffer& sound);
+    void addCached(const String& path, uint32_t hash, AudioBuffer& buffer);
+    bool releaseCached(uint8_t* data);
+    void evictCached(size_t needed);
+    bool evictOneCached();
+    bool readWavInfo(String path, WavInfo& info);
+    uint32_t librarySignature();
+    void updateIndex();
+
+    bool postCommand(AudioCommandType type, int32_t arg0 = 0, int32_t arg1 = 0, AudioBuffer* buffer = nullptr, Timeline* timeline = nullptr);
+    void collectTimelines();
+    uint8_t* retireBufferData(AudioBuffer& buffer);
+    void releaseBuffer(AudioBuffer& buffer);
+
+    static void loaderTask(void* param);
+    void runLoader();
+    bool requestLoad(LoadTarget target, const String& path);
+    void handleLoad(const LoadRequest& request);
+    bool loadInto(const String& path, AudioBuffer& buffer);
+    AudioBuffer* takeSpare(SoundType type);
+    void collectReleased();
+
+    static void audioTask(void* param);
+    void runAudio();
+    void processCommands();
+    void handleCommand(const AudioCommand& cmd);
+    void swapSound(SoundType type);
+    void applyPendingSwaps();
+    void returnRetired();
+    void releaseBeatEvents();
+    void retireTimeline(Timeline* timeline);
+
+    void fireScheduledBeat();
+    void renderBlock(int16_t* out, size_t frames);
+
 };
 
 extern SoundManager soundManager;
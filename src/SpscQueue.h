@@ -0,0 +1,50 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring buffer.
+// One task (or ISR) may push, exactly one other may pop. Neither side ever
+// blocks: push() fails when full and pop() fails when empty.
+// N must be a power of two.
+template <typename T, size_t N>
+class SpscQueue {
+public:
+    bool push(const T& item) {
+        size_t head = writeIndex.load(std::memory_order_relaxed);
+        if (head - readIndex.load(std::memory_order_acquire) >= N) return false;
+        items[head & (N - 1)] = item;
+        writeIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == writeIndex.load(std::memory_order_acquire)) return false;
+        item = items[tail & (N - 1)];
+        readIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() { return N; }
+
+    // Only safe while neither side is running
+    void clear() {
+        writeIndex.store(0);
+        readIndex.store(0);
+    }
+
+private:
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+    T items[N];
+    std::atomic<size_t> writeIndex{0};
+    std::atomic<size_t> readIndex{0};
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "StorageTask.h"
+#include "SoundManager.h"
+#include "TaskMonitor.h"
+#include <esp_timer.h>
+
+StorageTask storage;
+
+void StorageTask::begin(ProgramManager& programs) {
+    this->programs = &programs;
+    xTaskCreatePinnedToCore(storageTask, "storage", STORAGE_TASK_STACK, this, STORAGE_TASK_PRIORITY, &taskHandle, STORAGE_TASK_CORE);
+    TaskMonitor::add(TASK_STORAGE, "storage", taskHandle, STORAGE_TASK_STACK, 20);
+}
+
+bool StorageTask::listPrograms(uint8_t tag) {
+    StorageMessage request;
+    request.type = STORE_LIST_PROGRAMS;
+    request.tag = tag;
+    return post(request, "");
+}
+
+bool StorageTask::listSounds(uint8_t tag) {
+    StorageMessage request;
+    request.type = STORE_LIST_SOUNDS;
+    request.tag = tag;
+    return post(request, "");
+}
+
+bool StorageTask::loadProgram(const String& path, uint8_t tag) {
+    StorageMessage request;
+    request.type = STORE_LOAD;
+    request.tag = tag;
+    return post(request, path);
+}
+
+bool StorageTask::saveProgram(const String& path, const std::vector<SequenceStep>& sequence, const String& dbPath, const String& bPath, uint8_t tag) {
+    StorageMessage request;
+    request.type = STORE_SAVE;
+    request.tag = tag;
+    request.program = new ProgramData{sequence, dbPath, bPath};
+    if (post(request, path)) return true;
+    delete request.program;
+    return false;
+}
+
+bool StorageTask::deleteProgram(const String& path, uint8_t tag) {
+    StorageMessage request;
+    request.type = STORE_DELETE;
+    request.tag = tag;
+    return post(request, path);
+}
+
+bool StorageTask::newProgramName(uint8_t tag) {
+    StorageMessage request;
+    request.type = STORE_NEW_NAME;
+    request.tag = tag;
+    return post(request, "");
+}
+
+bool StorageTask::poll(StorageMessage& reply) {
+    return replies.pop(reply);
+}
+
+bool StorageTask::post(StorageMessage& request, const String& path) {
+    if (path.length() >= STORAGE_PATH_LEN) {
+        Serial.print("Path too long: "); Serial.println(path);
+        return false;
+    }
+    strcpy(request.path, path.c_str());
+
+    if (!requests.push(request)) {
+        Serial.println("Storage queue full!");
+        return false;
+    }
+    xTaskNotifyGive(taskHandle);
+    return true;
+}
+
+void StorageTask::storageTask(void* param) {
+    ((StorageTask*)param)->run();
+}
+
+void StorageTask::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        StorageMessage message;
+        while (requests.pop(message)) {
+            int64_t start = esp_timer_get_time();
+            handle(message);
+            TaskMonitor::busy(TASK_STORAGE, (uint32_t)(esp_timer_get_time() - start));
+
+            // The UI drains replies every loop(), so waiting here is short
+            while (!replies.push(message)) vTaskDelay(1);
+        }
+    }
+}
+
+void StorageTask::handle(StorageMessage& message) {
+    String path = message.path;
+
+    switch (message.type) {
+        case STORE_LIST_PROGRAMS:
+            message.list = new std::vector<String>(programs->listPrograms());
+            message.ok = true;
+            break;
+        case STORE_LIST_SOUNDS:
+            message.list = new std::vector<String>(soundManager.listWavs());
+            message.ok = true;
+            break;
+        case STORE_LOAD:
+            message.program = new ProgramData;
+            message.ok = programs->loadProgram(path, message.program->sequence, message.program->dbPath, message.program->bPath);
+            break;
+        case STORE_SAVE:
+            if (path.length() == 0) path = programs->getNextProgramName();
+            message.ok = path.length() < STORAGE_PATH_LEN &&
+                         programs->saveProgram(path, message.program->sequence, message.program->dbPath, message.program->bPath);
+            delete message.program; // Request data, not part of the reply
+            message.program = nullptr;
+            break;
+        case STORE_DELETE:
+            programs->deleteProgram(path);
+            message.ok = true;
+            break;
+        case STORE_NEW_NAME:
+            path = programs->getNextProgramName();
+            message.ok = path.length() < STORAGE_PATH_LEN;
+            break;
+    }
+
+    if (message.ok) strcpy(message.path, path.c_str());
+}
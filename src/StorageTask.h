@@ -0,0 +1,76 @@
+#ifndef STORAGETASK_H
+#define STORAGETASK_H
+
+#include <Arduino.h>
+#include <vector>
+#include "ProgramManager.h"
+#include "SpscQueue.h"
+
+// --- CONFIG ---
+#define STORAGE_TASK_CORE 0     // Shares the audio core, far below the mixer
+#define STORAGE_TASK_PRIORITY 1
+#define STORAGE_TASK_STACK 6144
+#define STORAGE_PATH_LEN 48
+// --------------
+
+// Low-priority worker for all LittleFS access of the UI (program files and
+// the sound list), so a slow file operation never holds up touch handling
+// or drawing. The UI posts requests and picks up replies in loop().
+
+enum StorageRequestType {
+    STORE_LIST_PROGRAMS, // Reply: list
+    STORE_LIST_SOUNDS,   // Reply: list
+    STORE_LOAD,          // path. Reply: program
+    STORE_SAVE,          // path ("" = pick a new name), program. Reply: path saved to
+    STORE_DELETE,        // path
+    STORE_NEW_NAME       // Reply: path of a free program name
+};
+
+// Program contents travel on the heap, the messages only carry the pointer.
+// Whoever receives a message owns (and deletes) what it points to.
+struct ProgramData {
+    std::vector<SequenceStep> sequence;
+    String dbPath;
+    String bPath;
+};
+
+struct StorageMessage {
+    uint8_t type = STORE_LIST_PROGRAMS; // StorageRequestType
+    uint8_t tag = 0;                    // Caller's, returned with the reply
+    bool ok = false;                    // Reply only
+    char path[STORAGE_PATH_LEN] = "";
+    ProgramData* program = nullptr;
+    std::vector<String>* list = nullptr;
+};
+
+class StorageTask {
+public:
+    // The task works on `programs`, which must outlive it
+    void begin(ProgramManager& programs);
+
+    // All of these return immediately. false: queue full or path too long.
+    bool listPrograms(uint8_t tag = 0);
+    bool listSounds(uint8_t tag = 0);
+    bool loadProgram(const String& path, uint8_t tag = 0);
+    bool saveProgram(const String& path, const std::vector<SequenceStep>& sequence, const String& dbPath, const String& bPath, uint8_t tag = 0);
+    bool deleteProgram(const String& path, uint8_t tag = 0);
+    bool newProgramName(uint8_t tag = 0);
+
+    // Next finished request, in order
+    bool poll(StorageMessage& reply);
+
+private:
+    TaskHandle_t taskHandle = nullptr;
+    ProgramManager* programs = nullptr;
+    SpscQueue<StorageMessage, 8> requests; // UI -> storage
+    SpscQueue<StorageMessage, 8> replies;  // Storage -> UI
+
+    bool post(StorageMessage& request, const String& path);
+    static void storageTask(void* param);
+    void run();
+    void handle(StorageMessage& message);
+};
+
+extern StorageTask storage;
+
+#endif
@@ -0,0 +1,57 @@
+#include "TaskMonitor.h"
+#include <esp_timer.h>
+
+struct TaskEntry {
+    const char* name = nullptr; // nullptr: not registered
+    TaskHandle_t handle = nullptr;
+    uint32_t stackBytes = 0;
+    uint8_t cpuBudget = 0;      // Percent of one core
+    uint32_t peakCpu = 0;       // Highest window so far, percent
+};
+
+static TaskEntry tasks[TASK_COUNT];
+static volatile uint32_t busyUs[TASK_COUNT];
+static uint32_t reportedBusyUs[TASK_COUNT];
+static int64_t windowStartUs = 0;
+
+void TaskMonitor::add(MonitoredTask id, const char* name, TaskHandle_t handle, uint32_t stackBytes, uint8_t cpuBudgetPercent) {
+    tasks[id].name = name;
+    tasks[id].handle = handle;
+    tasks[id].stackBytes = stackBytes;
+    tasks[id].cpuBudget = cpuBudgetPercent;
+    if (windowStartUs == 0) windowStartUs = esp_timer_get_time();
+}
+
+void TaskMonitor::busy(MonitoredTask id, uint32_t us) {
+    busyUs[id] += us;
+}
+
+void TaskMonitor::poll() {
+    if (TASK_REPORT_MS == 0) return;
+    if (esp_timer_get_time() - windowStartUs >= (int64_t)TASK_REPORT_MS * 1000) report();
+}
+
+void TaskMonitor::report() {
+    int64_t now = esp_timer_get_time();
+    uint32_t windowUs = (uint32_t)(now - windowStartUs);
+    windowStartUs = now;
+    if (windowUs == 0) return;
+
+    Serial.println("Task      core  stack used/size   cpu now/peak/budget");
+    for (int i = 0; i < TASK_COUNT; i++) {
+        TaskEntry& t = tasks[i];
+        if (!t.name) continue;
+
+        uint32_t total = busyUs[i];
+        uint32_t cpu = (uint32_t)((uint64_t)(total - reportedBusyUs[i]) * 100 / windowUs);
+        reportedBusyUs[i] = total;
+        if (cpu > t.peakCpu) t.peakCpu = cpu;
+
+        // High-water mark is the least free stack ever (bytes on ESP32)
+        uint32_t used = t.stackBytes - uxTaskGetStackHighWaterMark(t.handle);
+        bool over = cpu > t.cpuBudget || used * 4 > t.stackBytes * 3; // Stack > 75%
+
+        Serial.printf("%-9s %4d  %5u/%-5u  %8u%%/%u%%/%u%%%s\n", t.name, xTaskGetAffinity(t.handle),
+                      used, t.stackBytes, cpu, t.peakCpu, t.cpuBudget, over ? "  OVER BUDGET" : "");
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef TASKMONITOR_H
+#define TASKMONITOR_H
+
+#include <Arduino.h>
+
+// --- CONFIG ---
+#define TASK_REPORT_MS 10000 // Prints the task table this often (0 = never)
+// --------------
+
+// Task layout:
+//   core 0: audio (mixer, highest), loader and storage (low priority workers)
+//   core 1: UI (Arduino loop(): touch, drawing, beat display)
+// Each task reports the time it spent working. The report compares that and
+// the stack high-water mark against the budget the task was registered with.
+enum MonitoredTask {
+    TASK_AUDIO,
+    TASK_LOADER,
+    TASK_STORAGE,
+    TASK_UI,
+    TASK_COUNT
+};
+
+namespace TaskMonitor {
+    void add(MonitoredTask id, const char* name, TaskHandle_t handle, uint32_t stackBytes, uint8_t cpuBudgetPercent);
+
+    // Adds working time of the calling task (only that task calls it for its id)
+    void busy(MonitoredTask id, uint32_t us);
+
+    // Call periodically from one task: prints every TASK_REPORT_MS
+    void poll();
+    void report();
+}
+
+#endif
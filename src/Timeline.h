@@ -0,0 +1,195 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <Arduino.h>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include "ProgramManager.h"
+
+// --- CONFIG ---
+#define TIMELINE_MAX_BARS 1024 // 32 KB; ~34 min of 4/4 at 120 bpm
+#define RAMP_MIN_BPM 10        // Tempo ramps are clamped to this range
+#define RAMP_MAX_BPM 1000
+// --------------
+
+// One bar of a compiled program. Positions are in samples from the program
+// start. In a steady step, beat k of the bar lands on start + floor((startFraction +
+// k * (stepWhole * tempo + stepRemainder)) / tempo), the same exact fraction
+// BeatScheduler uses, so a whole step plays without rounding drift.
+// On a tempo ramp each beat has its own interval (TimelineRamp::advance).
+struct TimelineBar {
+    uint32_t start;         // Downbeat
+    uint32_t startFraction; // Of a sample, the downbeat was rounded down by (/ tempo, ramps: / 2^32)
+    uint32_t stepWhole;     // Beat interval, whole samples
+    uint32_t period;        // Ramp: minutes per beat of the downbeat, Q32 (2^32 / bpm)
+    uint32_t rampTempo;     // Ramp: bpm of the downbeat, Q16
+    uint16_t stepRemainder; // ... plus stepRemainder / tempo
+    uint16_t tempo;         // bpm (0: the bar is on a tempo ramp)
+    uint16_t accents;       // Bit n set: beat n plays the downbeat sound
+    uint16_t step;          // SequenceStep it comes from
+    uint16_t barInStep;
+    uint8_t beats;
+};
+
+// How the tempo moves from one beat to the next in a ramping step
+struct TimelineRamp {
+    uint8_t curve = RAMP_LINEAR;
+    int32_t delta = 0;   // Linear: bpm change per beat, Q16
+    uint32_t factor = 0; // Exponential: period multiplier per beat, Q24
+
+    // Moves from the beat at whole + fraction / 2^32 to the next one, then
+    // makes tempo/period those of that beat. Runs per beat on the mixer task:
+    // multiplies only, no division or float. A linear ramp refines 1 / bpm
+    // with Newton steps from the previous beat's value (1-4 steps).
+    void advance(uint32_t samplesPerMinute, uint32_t& tempo, uint32_t& period, uint64_t& whole, uint32_t& fraction) const {
+        uint64_t sum = (uint64_t)fraction + (uint64_t)samplesPerMinute * period;
+        whole += sum >> 32;
+        fraction = (uint32_t)sum;
+
+        if (curve == RAMP_EXPONENTIAL) {
+            period = (uint32_t)(((uint64_t)period * factor) >> 24);
+            return;
+        }
+        tempo += delta;
+        for (int i = 0; i < 4; i++) {
+            // tempo * period is 2^48 when period is exact
+            int64_t error = (int64_t)(1ULL << 48) - (int64_t)((uint64_t)tempo * period);
+            if (error > -(1 << 20) && error < (1 << 20)) break; // Within 2^-28
+            period += (int32_t)(((int64_t)period * (error >> 16)) >> 32);
+        }
+    }
+};
+
+// A program flattened into its bars, compiled once by the UI before playback.
+// The mixer task walks it one beat at a time (BeatScheduler) and never
+// touches the sequence itself.
+class Timeline {
+public:
+    // false: empty, too many bars or longer than the 32-bit sample range
+    bool compile(const std::vector<SequenceStep>& sequence, uint32_t sampleRate) {
+        bars.clear();
+        ramps.assign(sequence.size(), TimelineRamp());
+        total = 0;
+        spm = sampleRate * 60;
+
+        size_t count = 0;
+        for (const auto& step : sequence) {
+            if (step.bars > 0) count += step.bars;
+        }
+        if (count == 0 || count > TIMELINE_MAX_BARS) return false;
+        bars.reserve(count);
+
+        const uint64_t samplesPerMinute = (uint64_t)sampleRate * 60;
+        uint64_t stepStart = 0;
+        for (size_t s = 0; s < sequence.size(); s++) {
+            const SequenceStep& step = sequence[s];
+            if (step.bars < 1) continue;
+            uint32_t bpm = constrain(step.bpm, 1, 65535);
+            uint32_t beats = constrain(step.beatsPerBar, 1, 255);
+
+            if (step.isRamp() && beats * step.bars > 1) {
+                if (!compileRamp(step, s, beats, stepStart)) {
+                    bars.clear();
+                    return false;
+                }
+                continue;
+            }
+
+            // Bar b starts b * beats beat intervals into the step, exactly
+            const uint64_t barSpan = samplesPerMinute * beats; // Bar length * bpm
+            for (int b = 0; b < step.bars; b++) {
+                uint64_t offset = barSpan * b;
+                TimelineBar bar = {};
+                bar.start = (uint32_t)(stepStart + offset / bpm);
+                bar.stepWhole = (uint32_t)(samplesPerMinute / bpm);
+                bar.stepRemainder = (uint16_t)(samplesPerMinute % bpm);
+                bar.tempo = (uint16_t)bpm;
+                bar.startFraction = (uint16_t)(offset % bpm);
+                bar.accents = 1; // Downbeat
+                bar.step = (uint16_t)s;
+                bar.barInStep = (uint16_t)b;
+                bar.beats = (uint8_t)beats;
+                bars.push_back(bar);
+            }
+            stepStart += barSpan * step.bars / bpm;
+            if (stepStart > UINT32_MAX) {
+                bars.clear();
+                return false;
+            }
+        }
+        total = (uint32_t)stepStart;
+        return true;
+    }
+
+    size_t size() const { return bars.size(); }
+    const TimelineBar& bar(size_t index) const { return bars[index]; }
+    const TimelineRamp& ramp(uint16_t step) const { return ramps[step]; }
+    uint32_t samplesPerMinute() const { return spm; }
+
+    // Samples from the first downbeat to the end of the last bar
+    uint32_t length() const { return total; }
+
+    // Bar playing at `position` (samples from the program start), O(log n)
+    size_t barAt(uint32_t position) const {
+        auto after = std::upper_bound(bars.begin(), bars.end(), position,
+            [](uint32_t pos, const TimelineBar& bar) { return pos < bar.start; });
+        return after == bars.begin() ? 0 : (after - bars.begin()) - 1;
+    }
+
+    // Bar `barInStep` of sequence step `step`, O(log n). size(): no such bar.
+    size_t barOf(uint16_t step, uint16_t barInStep) const {
+        auto first = std::lower_bound(bars.begin(), bars.end(), step,
+            [](const TimelineBar& bar, uint16_t s) { return bar.step < s; });
+        size_t index = (first - bars.begin()) + barInStep;
+        if (index >= bars.size() || bars[index].step != step) return bars.size();
+        return index;
+    }
+
+private:
+    std::vector<TimelineBar> bars;
+    std::vector<TimelineRamp> ramps; // [step], used by ramping steps only
+    uint32_t total = 0;
+    uint32_t spm = 0;
+
+    // Walks the ramp beat by beat with the scheduler's own arithmetic, so
+    // every downbeat lands exactly where playback will put it
+    bool compileRamp(const SequenceStep& step, uint16_t index, uint32_t beats, uint64_t& stepStart) {
+        uint32_t from = constrain(step.bpm, RAMP_MIN_BPM, RAMP_MAX_BPM);
+        uint32_t to = constrain(step.endBpm, RAMP_MIN_BPM, RAMP_MAX_BPM);
+        int32_t intervals = beats * step.bars - 1; // The last beat plays at endBpm
+
+        TimelineRamp& ramp = ramps[index];
+        ramp.curve = step.curve == RAMP_EXPONENTIAL ? RAMP_EXPONENTIAL : RAMP_LINEAR;
+        ramp.delta = ((int32_t)to - (int32_t)from) * 65536 / intervals;
+        ramp.factor = (uint32_t)(pow((double)from / to, 1.0 / intervals) * (1 << 24) + 0.5);
+        // Newton only converges quickly while a beat changes the tempo by at
+        // most a quarter. Steeper ramps play exponentially.
+        uint32_t slowest = from < to ? from : to;
+        if ((uint32_t)abs(ramp.delta) > (slowest << 16) / 4) ramp.curve = RAMP_EXPONENTIAL;
+
+        uint32_t tempo = from << 16;
+        uint32_t period = (uint32_t)((1ULL << 48) / tempo);
+        uint64_t whole = stepStart;
+        uint32_t fraction = 0;
+        for (int b = 0; b < step.bars; b++) {
+            if (whole > UINT32_MAX) return false;
+            TimelineBar bar = {};
+            bar.start = (uint32_t)whole;
+            bar.startFraction = fraction;
+            bar.period = period;
+            bar.rampTempo = tempo;
+            bar.tempo = 0;
+            bar.accents = 1;
+            bar.step = index;
+            bar.barInStep = (uint16_t)b;
+            bar.beats = (uint8_t)beats;
+            bars.push_back(bar);
+            for (uint32_t k = 0; k < beats; k++) ramp.advance(spm, tempo, period, whole, fraction);
+        }
+        stepStart = whole; // The next step starts on a whole sample
+        return stepStart <= UINT32_MAX;
+    }
+};
+
+#endif
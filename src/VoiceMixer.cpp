@@ -0,0 +1,115 @@
+#include "VoiceMixer.h"
+#include "SoundManager.h"
+
+// Decoded ADPCM, always 16-bit signed
+struct Pcm16 {
+    typedef int16_t Sample;
+    static inline int32_t toPcm16(Sample s) { return s; }
+};
+
+// Adds n frames to acc. Returns the number of frames mixed before a ramp ended.
+// Format is OutputBackend for PCM buffers (fixed at compile time) or Pcm16.
+template <typename Format>
+static size_t mixFrames(const typename Format::Sample* src, int32_t* acc, size_t n, int32_t& gain, int32_t gainStep) {
+    if (gainStep == 0) {
+        if (gain == 32768) {
+            for (size_t i = 0; i < n; i++) acc[i] += Format::toPcm16(src[i]);
+        } else {
+            for (size_t i = 0; i < n; i++) acc[i] += (Format::toPcm16(src[i]) * gain) >> 15;
+        }
+        return n;
+    }
+
+    int32_t g = gain;
+    size_t i = 0;
+    for (; i < n && g > 0; i++) {
+        acc[i] += (Format::toPcm16(src[i]) * g) >> 15;
+        g -= gainStep;
+    }
+    gain = g;
+    return i;
+}
+
+bool VoiceMixer::mixVoice(Voice& voice, int32_t* acc, size_t frames) {
+    AudioBuffer* buffer = voice.buffer;
+    const uint8_t* data = buffer->data;
+    if (!data) return false; // Sound was unloaded
+
+    // Buffers are always mono at the output rate (converted on load)
+    size_t total = buffer->frames;
+    if (voice.position >= total) return false;
+
+    size_t n = total - voice.position;
+    if (n > frames) n = frames;
+
+    size_t mixed = 0;
+    if (buffer->format == SAMPLE_SYNTH) {
+        // Rendered in short runs, like ADPCM is decoded
+        if (voice.position == 0) ClickSynth::start(*(const SynthPreset*)data, buffer->accent, voice.synth);
+        int16_t rendered[AUDIO_BLOCK_FRAMES];
+        while (mixed < n) {
+            size_t run = n - mixed;
+            if (run > AUDIO_BLOCK_FRAMES) run = AUDIO_BLOCK_FRAMES;
+            ClickSynth::render(voice.synth, rendered, run);
+            size_t done = mixFrames<Pcm16>(rendered, acc + mixed, run, voice.gain, voice.gainStep);
+            mixed += done;
+            if (done < run) break;
+        }
+    } else if (buffer->format == SAMPLE_ADPCM) {
+        // Decoded in short runs into a scratch block on the mixer task stack
+        int16_t decoded[AUDIO_BLOCK_FRAMES];
+        while (mixed < n) {
+            size_t run = n - mixed;
+            if (run > AUDIO_BLOCK_FRAMES) run = AUDIO_BLOCK_FRAMES;
+            Adpcm::decode(data, voice.position + mixed, run, decoded, voice.adpcm);
+            size_t done = mixFrames<Pcm16>(decoded, acc + mixed, run, voice.gain, voice.gainStep);
+            mixed += done;
+            if (done < run) break;
+        }
+    } else {
+        const AudioSample* src = (const AudioSample*)data + voice.position;
+        mixed = mixFrames<OutputBackend>(src, acc, n, voice.gain, voice.gainStep);
+    }
+    voice.position += mixed;
+
+    return mixed == n && voice.position < total;
+}
+
+void VoiceMixer::trigger(AudioBuffer* buffer, int32_t gain) {
+    if (!buffer || !buffer->data) return;
+
+    Voice* slot = nullptr;
+    for (int i = 0; i < MIXER_VOICES; i++) {
+        if (!voices[i].buffer) { slot = &voices[i]; break; }
+    }
+
+    if (!slot) {
+        // Steal the oldest voice, let it ramp out in the fade slot
+        slot = &voices[0];
+        for (int i = 1; i < MIXER_VOICES; i++) {
+            if ((int32_t)(voices[i].startOrder - slot->startOrder) < 0) slot = &voices[i];
+        }
+        fading = *slot;
+        fading.gainStep = fading.gain / DECLICK_FRAMES + 1; // From wherever its level was
+    }
+
+    slot->buffer = buffer;
+    slot->position = 0;
+    slot->startOrder = triggerCount++;
+    slot->gain = gain;
+    slot->gainStep = 0;
+}
+
+void VoiceMixer::mix(int32_t* acc, size_t frames) {
+    for (int i = 0; i < MIXER_VOICES; i++) {
+        if (voices[i].buffer && !mixVoice(voices[i], acc, frames)) voices[i].buffer = nullptr;
+    }
+    if (fading.buffer && !mixVoice(fading, acc, frames)) fading.buffer = nullptr;
+}
+
+bool VoiceMixer::isPlaying(const AudioBuffer* buffer) const {
+    for (int i = 0; i < MIXER_VOICES; i++) {
+        if (voices[i].buffer == buffer) return true;
+    }
+    return fading.buffer == buffer;
+}
@@ -0,0 +1,47 @@
+#ifndef VOICEMIXER_H
+#define VOICEMIXER_H
+
+#include <Arduino.h>
+#include "Adpcm.h"
+#include "ClickSynth.h"
+
+struct AudioBuffer;
+
+// --- CONFIG ---
+#define MIXER_VOICES 4     // Simultaneous sounds (overlapping clicks + preview)
+#define DECLICK_FRAMES 64  // Fade-out length of a stolen voice (~1.5 ms)
+// --------------
+
+// Fixed pool of sample voices, summed into a 32-bit accumulator.
+// Owned by the mixer task, nothing here is thread safe.
+class VoiceMixer {
+public:
+    // Starts a sound at a fixed Q15 gain. If all voices are busy the oldest
+    // one is stolen and faded out over DECLICK_FRAMES instead of being cut off.
+    void trigger(AudioBuffer* buffer, int32_t gain = 32768);
+
+    // Adds the next `frames` samples of all voices to acc
+    void mix(int32_t* acc, size_t frames);
+
+    // True while any voice (or the fade slot) still reads from buffer
+    bool isPlaying(const AudioBuffer* buffer) const;
+
+private:
+    struct Voice {
+        AudioBuffer* buffer = nullptr;
+        size_t position = 0;     // In frames
+        uint32_t startOrder = 0; // For voice stealing (lowest = oldest)
+        int32_t gain = 32768;    // Q15, set per trigger, only ramps on a stolen voice
+        int32_t gainStep = 0;
+        Adpcm::State adpcm;      // Decoder state at `position` (ADPCM buffers)
+        ClickSynth::State synth; // Generator state at `position` (synth buffers)
+    };
+
+    Voice voices[MIXER_VOICES];
+    Voice fading; // Stolen voice, ramping out
+    uint32_t triggerCount = 0;
+
+    static bool mixVoice(Voice& voice, int32_t* acc, size_t frames);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "WavParser.h"
+
+namespace {
+
+// Whole file in memory
+struct SpanSource {
+    const uint8_t* data;
+    size_t size;
+
+    size_t length() const { return size; }
+    bool read(uint32_t offset, uint8_t* out, size_t n) {
+        if (offset > size || n > size - offset) return false;
+        memcpy(out, data + offset, n);
+        return true;
+    }
+};
+
+// Open file, read at absolute offsets
+struct FileSource {
+    fs::File& file;
+
+    size_t length() const { return file.size(); }
+    bool read(uint32_t offset, uint8_t* out, size_t n) {
+        return file.seek(offset) && file.read(out, n) == n;
+    }
+};
+
+inline uint16_t le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+inline uint32_t le32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+bool isSupported(const WavInfo& info) {
+    if (info.formatCode != 1) return false; // PCM only
+    if (info.channels < 1 || info.channels > 2) return false;
+    if (info.bitsPerSample != 8 && info.bitsPerSample != 16) return false;
+    return info.sampleRate >= RESAMPLER_MIN_RATE && info.sampleRate <= WAV_MAX_RATE;
+}
+
+template <typename Source>
+WavStatus parseChunks(Source& src, WavInfo& info) {
+    const uint64_t fileSize = src.length();
+    uint8_t header[16];
+
+    if (!src.read(0, header, 12)) return WAV_NOT_WAVE;
+    if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) return WAV_NOT_WAVE;
+
+    bool foundFmt = false;
+    uint64_t pos = 12;
+    while (pos + 8 <= fileSize) {
+        if (!src.read((uint32_t)pos, header, 8)) return WAV_TRUNCATED;
+        uint32_t chunkSize = le32(header + 4);
+        uint64_t body = pos + 8;
+
+        if (memcmp(header, "fmt ", 4) == 0) {
+            if (chunkSize < 16) return WAV_BAD_FMT;
+            if (!src.read((uint32_t)body, header, 16)) return WAV_TRUNCATED;
+            info.formatCode = le16(header);
+            info.channels = le16(header + 2);
+            info.sampleRate = le32(header + 4);
+            info.blockAlign = le16(header + 12);
+            info.bitsPerSample = le16(header + 14);
+            if (info.channels == 0 || info.blockAlign == 0) return WAV_BAD_FMT;
+            if (info.blockAlign != info.channels * ((info.bitsPerSample + 7) / 8)) return WAV_BAD_FMT;
+            // Checked here, not after data: data sizes are divided by blockAlign
+            if (info.bitsPerSample != 8 && info.bitsPerSample != 16) return WAV_UNSUPPORTED;
+            foundFmt = true;
+
+        } else if (memcmp(header, "data", 4) == 0) {
+            if (!foundFmt) return WAV_BAD_FMT; // fmt must come first
+            uint64_t available = fileSize - body;
+            uint32_t size = (chunkSize < available) ? chunkSize : (uint32_t)available;
+            info.dataOffset = (uint32_t)body;
+            info.dataSize = size - size % info.blockAlign;
+            if (info.dataSize == 0) return WAV_NO_DATA;
+            return isSupported(info) ? WAV_OK : WAV_UNSUPPORTED;
+        }
+
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+    return foundFmt ? WAV_NO_DATA : WAV_BAD_FMT;
+}
+
+}
+
+WavStatus WavParser::parse(const uint8_t* data, size_t size, WavInfo& info) {
+    SpanSource src = {data, size};
+    return parseChunks(src, info);
+}
+
+WavStatus WavParser::parse(fs::File& file, WavInfo& info) {
+    FileSource src = {file};
+    return parseChunks(src, info);
+}
+
+const char* WavParser::describe(WavStatus status) {
+    switch (status) {
+        case WAV_OK: return "OK";
+        case WAV_NOT_WAVE: return "Not a WAV file";
+        case WAV_TRUNCATED: return "Truncated header";
+        case WAV_BAD_FMT: return "Missing or invalid fmt chunk";
+        case WAV_NO_DATA: return "No audio data";
+        case WAV_UNSUPPORTED: return "Unsupported format (PCM 8/16-bit, mono/stereo, 8-48 kHz)";
+    }
+    return "Unknown";
+}
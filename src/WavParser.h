@@ -0,0 +1,43 @@
+#ifndef WAVPARSER_H
+#define WAVPARSER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "Resampler.h"
+
+// Accepted by the loader (anything else is rejected while listing)
+#define WAV_MAX_RATE 48000
+
+struct WavInfo {
+    uint16_t formatCode = 0;
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t blockAlign = 0;    // Bytes per frame
+    uint16_t bitsPerSample = 0;
+    uint32_t dataOffset = 0;    // From the start of the file
+    uint32_t dataSize = 0;      // Whole frames only, never past the end of the file
+
+    uint32_t frames() const { return blockAlign ? dataSize / blockAlign : 0; }
+};
+
+enum WavStatus {
+    WAV_OK,
+    WAV_NOT_WAVE,    // No RIFF/WAVE header
+    WAV_TRUNCATED,   // A header or the fmt chunk runs past the end
+    WAV_BAD_FMT,     // fmt missing, too short or inconsistent
+    WAV_NO_DATA,     // No (non-empty) data chunk
+    WAV_UNSUPPORTED  // Valid, but not PCM 8/16-bit mono/stereo 8-48 kHz
+};
+
+// Single-pass RIFF chunk walker, shared by listing and loading.
+// Every read is bounds checked against the real file size (the RIFF size
+// field is ignored), odd chunks are padded, unknown chunks are skipped and
+// a data chunk cut short by a truncated file is clamped to what is there.
+namespace WavParser {
+    WavStatus parse(const uint8_t* data, size_t size, WavInfo& info);
+    WavStatus parse(fs::File& file, WavInfo& info); // Reads only chunk headers and fmt
+
+    const char* describe(WavStatus status);
+}
+
+#endif
@@ -12,6 +12,12 @@
 
 #include "ProgramManager.h"
 
+#include "StorageTask.h"
+
+#include "TaskMonitor.h"
+
+#include "AllocDebug.h"
+
 
 
 // --- Hardware Definitions ---
@@ -72,14 +78,12 @@ XPT2046_Bitbang ts(XPT2046_MOSI, XPT2046_MISO, XPT2046_CLK, XPT2046_CS);
 
 int bpm = 120;
 
-int volume = 127; 
+int volume = 217; // -6 dB, as loud as 127 was before levels were in dB (see GainStage.h)
 
 bool isPlaying = false;
 
 unsigned long lastTouchTime = 0;
 
-unsigned long lastClickTime = 0;
-
 unsigned long lastVisualBeatTime = 0;
 
 bool visualBeatActive = false;
@@ -116,6 +120,8 @@ String currentProgramPath = ""; // Path of currently loaded program
 
 bool isSequenceMode = false;
 
+bool isPaused = false; // Program playback held (PAUSE in the editor)
+
 bool isLoopMode = true; // Default to looping
 
 int currentStepIndex = 0;
@@ -138,6 +144,10 @@ int selectedSoundIndex = -1;
 
 SoundType targetSoundType = SOUND_DOWNBEAT; // Which sound are we selecting?
 
+#define LEVEL_STEP 19 // Per tap on the level buttons: ~3 dB (see GainStage.h)
+
+#define SEEK_BACK_SECONDS 10 // Editor "<<" while a program plays
+
 
 
 // --- Program Selection State ---
@@ -150,6 +160,18 @@ int selectedProgramIndex = -1;
 
 
 
+// --- Tasks ---
+
+// loop() is the UI task (core 1). Storage replies are tagged with what to do next.
+
+#define UI_TASK_PRIORITY 2 // Above the loader and storage workers
+
+#define UI_TASK_STACK 8192 // Arduino loop task (CONFIG_ARDUINO_LOOP_STACK_SIZE)
+
+enum StorageTag { TAG_NONE, TAG_EDIT, TAG_PLAY };
+
+
+
 // --- Forward Declarations ---
 
 void updateBPM();
@@ -176,6 +198,8 @@ void increaseVol();
 
 void decreaseVol();
 
+void toggleOutputChain();
+
 void cycleTimeSig();
 
 void toggleEditor(); 
@@ -196,6 +220,10 @@ void refreshSoundList();
 
 void refreshProgramList();
 
+void handleStorageReply(StorageMessage& reply);
+
+void updateUi();
+
 void handleTouchProgramSelect(int x, int y);
 
 
@@ -254,7 +282,11 @@ Button buttons[] = {
 
   {5, 195, 60, 40, "-", TFT_DARKGREY, decreaseVol, false},
 
-  {255, 195, 60, 40, "+", TFT_DARKGREY, increaseVol, false}
+  {255, 195, 60, 40, "+", TFT_DARKGREY, increaseVol, false},
+
+  // The volume bar itself: tap to switch the speaker EQ (drawn by drawVolumeBar)
+
+  {75, 195, 170, 40, "", TFT_BLACK, toggleOutputChain, true}
 
 };
 
@@ -396,6 +428,18 @@ void drawButton(int index) {
 
   
 
+  if (b.isCustomDraw) {
+
+      tft.fillRect(b.x, b.y, b.w, b.h, TFT_BLACK); // Also clears the touch highlight
+
+      drawVolumeBar();
+
+      return;
+
+  }
+
+  
+
   // Special handling for Play/Stop button color/label
 
   if (index == 5) { // Play/Stop Button
@@ -502,9 +546,9 @@ void drawVolumeBar() {
 
   uint16_t barColor = TFT_GREEN;
 
-  if (volume > 200) barColor = TFT_RED;
+  if (volume > 241) barColor = TFT_RED; // Above -2 dB
 
-  else if (volume > 100) barColor = TFT_YELLOW;
+  else if (volume > 203) barColor = TFT_YELLOW; // Above -8 dB
 
   
 
@@ -512,6 +556,14 @@ void drawVolumeBar() {
 
   tft.fillRect(VOL_BAR_X + 1 + fillW, VOL_BAR_Y + 1, VOL_BAR_W - 2 - fillW, VOL_BAR_H - 2, TFT_BLACK);
 
+
+
+  // Speaker EQ + limiter (OutputChain), switched by tapping the bar
+
+  tft.fillRect(VOL_BAR_X, VOL_BAR_Y + VOL_BAR_H + 1, VOL_BAR_W, 10, TFT_BLACK);
+
+  tft.drawString(soundManager.getOutputChain() ? "SPEAKER EQ ON" : "SPEAKER EQ OFF", VOL_BAR_X + VOL_BAR_W / 2, VOL_BAR_Y + VOL_BAR_H + 2);
+
 }
 
 
@@ -590,6 +642,26 @@ void drawEditor() {
 
 
 
+  // Back SEEK_BACK_SECONDS while playing (the step highlight follows the beats)
+
+  if (isSequenceMode) {
+
+      tft.setTextSize(1);
+
+      tft.setTextDatum(MC_DATUM);
+
+      tft.drawRoundRect(170, 2, 40, 25, 3, TFT_YELLOW);
+
+      tft.setTextColor(TFT_YELLOW, TFT_BLACK);
+
+      tft.drawString("<< " + String(SEEK_BACK_SECONDS), 190, 14);
+
+      tft.setTextColor(TFT_WHITE, TFT_BLACK);
+
+  }
+
+
+
   // Scroll Buttons
 
   if (sequence.size() > 5) {
@@ -708,6 +780,40 @@ void drawEditor() {
 
     tft.drawString(line, 20, y);
 
+    // Tempo ramp: a slope (bent for exponential) and the end tempo, small
+
+    if (sequence[i].isRamp()) {
+
+        int rx = 20 + tft.textWidth(line) + 3;
+
+        bool up = sequence[i].endBpm > sequence[i].bpm;
+
+        int y0 = up ? y + 13 : y + 1;
+
+        int y1 = up ? y + 1 : y + 13;
+
+        if (sequence[i].curve == RAMP_EXPONENTIAL) {
+
+            int bendY = up ? y + 10 : y + 4;
+
+            tft.drawLine(rx, y0, rx + 6, bendY, textColor);
+
+            tft.drawLine(rx + 6, bendY, rx + 10, y1, textColor);
+
+        } else {
+
+            tft.drawLine(rx, y0, rx + 10, y1, textColor);
+
+        }
+
+        tft.setTextSize(1);
+
+        tft.drawString(String(sequence[i].endBpm), rx + 13, y + 4);
+
+        tft.setTextSize(2);
+
+    }
+
   }
 
 
@@ -726,9 +832,17 @@ void drawEditor() {
 
   
 
-  // ADD (x=10, w=50)
+  // ADD (x=10, w=50) - PAUSE / RESUME while playing
+
+  if (isSequenceMode) {
 
-  tft.drawRoundRect(10, yBase, 50, 35, 5, TFT_GREEN); tft.drawString("ADD", 35, yBase + 17);
+      tft.drawRoundRect(10, yBase, 50, 35, 5, TFT_YELLOW); tft.drawString(isPaused ? ">" : "||", 35, yBase + 17);
+
+  } else {
+
+      tft.drawRoundRect(10, yBase, 50, 35, 5, TFT_GREEN); tft.drawString("ADD", 35, yBase + 17);
+
+  }
 
   
 
@@ -772,7 +886,7 @@ void drawEditor() {
 
      int xBase = 220;
 
-     int yStart = 40;
+     int yStart = 36;
 
      tft.setTextSize(1);
 
@@ -782,29 +896,45 @@ void drawEditor() {
 
      tft.drawString("Bars", xBase + 40, yStart);
 
-     tft.drawRoundRect(xBase, yStart + 10, 30, 30, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 25);
+     tft.drawRoundRect(xBase, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 21);
 
-     tft.drawRoundRect(xBase + 50, yStart + 10, 30, 30, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 25);
+     tft.drawRoundRect(xBase + 50, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 21);
 
      
 
-     yStart += 50;
+     yStart += 38;
 
      tft.drawString("Sig", xBase + 40, yStart);
 
-     tft.drawRoundRect(xBase, yStart + 10, 30, 30, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 25);
+     tft.drawRoundRect(xBase, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 21);
 
-     tft.drawRoundRect(xBase + 50, yStart + 10, 30, 30, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 25);
+     tft.drawRoundRect(xBase + 50, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 21);
 
 
 
-     yStart += 50;
+     yStart += 38;
 
      tft.drawString("BPM", xBase + 40, yStart);
 
-     tft.drawRoundRect(xBase, yStart + 10, 30, 30, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 25);
+     tft.drawRoundRect(xBase, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 21);
+
+     tft.drawRoundRect(xBase + 50, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 21);
+
+
+
+     // Tempo ramp: -/+ set the end tempo, the letter between them the curve
 
-     tft.drawRoundRect(xBase + 50, yStart + 10, 30, 30, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 25);
+     yStart += 38;
+
+     const SequenceStep& step = sequence[selectedStepIndex];
+
+     tft.drawString(step.isRamp() ? "End BPM" : "Ramp", xBase + 40, yStart);
+
+     tft.drawRoundRect(xBase, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("-", xBase + 15, yStart + 21);
+
+     tft.drawRoundRect(xBase + 50, yStart + 8, 30, 26, 3, TFT_WHITE); tft.drawString("+", xBase + 65, yStart + 21);
+
+     if (step.isRamp()) tft.drawString(step.curve == RAMP_EXPONENTIAL ? "E" : "L", xBase + 40, yStart + 21);
 
   }
 
@@ -918,21 +1048,29 @@ void drawSoundSelect() {
 
     tft.drawRoundRect(210, yBase, 100, 35, 5, TFT_GREEN); tft.drawString("SELECT", 260, yBase + 17);
 
-}
 
 
+    // Level of the sound on this tab, in dB below full
 
-void refreshSoundList() {
+    uint8_t level = soundManager.getLevel(targetSoundType);
 
-    wavFiles = soundManager.listWavs();
+    String levelText = (level == 0) ? String("off") : String(-(int)lround(GAIN_RANGE_DB * (255 - level) / 255.0));
 
-    
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
 
-    selectedSoundIndex = -1;
+    tft.drawRoundRect(115, yBase, 25, 35, 5, TFT_DARKGREY); tft.drawString("-", 127, yBase + 17);
 
-    soundListScroll = 0;
+    tft.drawString(levelText, 160, yBase + 17);
 
-    drawSoundSelect();
+    tft.drawRoundRect(180, yBase, 25, 35, 5, TFT_DARKGREY); tft.drawString("+", 192, yBase + 17);
+
+}
+
+
+
+void refreshSoundList() {
+
+    storage.listSounds(); // Drawn when the list arrives (handleStorageReply)
 
 }
 
@@ -1035,6 +1173,32 @@ void handleTouchSoundSelect(int x, int y) {
 
 
 
+    // Level of the sound on this tab (saved by SoundManager)
+
+    if (y > yBase && x > 115 && x < 205) {
+
+        int level = soundManager.getLevel(targetSoundType);
+
+        if (x < 140) level -= LEVEL_STEP;
+
+        else if (x > 180) level += LEVEL_STEP;
+
+        else return;
+
+        if (level < 0) level = 0;
+
+        if (level > 255) level = 255;
+
+        soundManager.setLevel(targetSoundType, (uint8_t)level);
+
+        drawSoundSelect();
+
+        return;
+
+    }
+
+
+
     // SELECT
 
     if (y > yBase && x > 210) {
@@ -1063,6 +1227,18 @@ void handleTouchSoundSelect(int x, int y) {
 
 void handleTouchEditor(int x, int y) {
 
+  // Seek back (next downbeat)
+
+  if (y < 30 && x > 170 && x < 210 && isSequenceMode) {
+
+      soundManager.seekBy(-SEEK_BACK_SECONDS);
+
+      return;
+
+  }
+
+
+
   // Scroll Buttons
 
   if (y < 30 && x > 210) {
@@ -1103,6 +1279,10 @@ void handleTouchEditor(int x, int y) {
 
       selectedStepIndex = i;
 
+      // Playing: continue from this step at the next downbeat
+
+      if (isSequenceMode) soundManager.jumpTo(i);
+
       drawEditor();
 
       return;
@@ -1115,13 +1295,29 @@ void handleTouchEditor(int x, int y) {
 
   int yBase = 200; // Adjusted
 
+  // PAUSE / RESUME (keeps the beat phase)
+
+  if (y > yBase && y < yBase + 35 && x > 10 && x < 60 && isSequenceMode) {
+
+    isPaused = !isPaused;
+
+    if (isPaused) soundManager.pauseMetronome();
+
+    else soundManager.resumeMetronome();
+
+    drawEditor();
+
+    return;
+
+  }
+
   // ADD
 
   if (y > yBase && y < yBase + 35 && x > 10 && x < 60) {
 
     // Removed limit check
 
-    sequence.push_back({4, 4, 120});
+    sequence.push_back({4, 4, 120, 0, RAMP_LINEAR});
 
     selectedStepIndex = sequence.size() - 1;
 
@@ -1145,6 +1341,8 @@ void handleTouchEditor(int x, int y) {
 
       sequence.erase(sequence.begin() + selectedStepIndex);
 
+      if (isSequenceMode) soundManager.updateProgram(sequence);
+
       if (selectedStepIndex >= sequence.size()) selectedStepIndex = sequence.size() - 1;
 
       drawEditor();
@@ -1167,6 +1365,8 @@ void handleTouchEditor(int x, int y) {
 
     isLoopMode = !isLoopMode;
 
+    soundManager.setProgramLoop(isLoopMode); // Also while playing
+
     drawEditor();
 
   }
@@ -1181,8 +1381,12 @@ void handleTouchEditor(int x, int y) {
 
         isSequenceMode = false;
 
+        isPaused = false;
+
         isPlaying = false;
 
+        soundManager.stopMetronome();
+
         currentStepIndex = 0;
 
         barsPlayedInStep = 0;
@@ -1201,15 +1405,7 @@ void handleTouchEditor(int x, int y) {
 
     
 
-    String savePath = currentProgramPath;
-
-    if (savePath.length() == 0) {
-
-        savePath = programManager.getNextProgramName();
-
-    }
-
-    
+    String savePath = currentProgramPath; // Empty: the storage task picks a new name
 
     tft.fillScreen(TFT_BLACK);
 
@@ -1221,19 +1417,9 @@ void handleTouchEditor(int x, int y) {
 
     tft.drawString(savePath, 160, 150); // Show path being saved
 
-    
-
-    if (programManager.saveProgram(savePath, sequence, soundManager.getDownbeatPath(), soundManager.getBeatPath())) {
-
-        delay(500);
+    // Finished in handleStorageReply
 
-        // Go back to Program Select
-
-        currentScreen = SCREEN_PROGRAM_SELECT;
-
-        refreshProgramList();
-
-    } else {
+    if (!storage.saveProgram(savePath, sequence, soundManager.getDownbeatPath(), soundManager.getBeatPath())) {
 
         tft.drawString("Error Saving!", 160, 140);
 
@@ -1253,18 +1439,20 @@ void handleTouchEditor(int x, int y) {
 
      int xBase = 220;
 
-     int yStart = 40;
+     int yStart = 36;
 
      
 
      // Bars
 
-     if (y > yStart + 10 && y < yStart + 40) {
+     if (y > yStart + 8 && y < yStart + 34) {
 
        if (x > xBase && x < xBase + 30) { sequence[selectedStepIndex].bars--; if(sequence[selectedStepIndex].bars < 1) sequence[selectedStepIndex].bars = 1; }
 
        if (x > xBase + 50 && x < xBase + 80) { sequence[selectedStepIndex].bars++; }
 
+       if (isSequenceMode) soundManager.updateProgram(sequence);
+
        drawEditor();
 
      }
@@ -1273,9 +1461,9 @@ void handleTouchEditor(int x, int y) {
 
      // Sig
 
-     yStart += 50;
+     yStart += 38;
 
-     if (y > yStart + 10 && y < yStart + 40) {
+     if (y > yStart + 8 && y < yStart + 34) {
 
        if (x > xBase && x < xBase + 30) { 
 
@@ -1293,6 +1481,8 @@ void handleTouchEditor(int x, int y) {
 
        }
 
+       if (isSequenceMode) soundManager.updateProgram(sequence);
+
        drawEditor();
 
      }
@@ -1301,14 +1491,40 @@ void handleTouchEditor(int x, int y) {
 
      // BPM
 
-     yStart += 50;
+     yStart += 38;
 
-     if (y > yStart + 10 && y < yStart + 40) {
+     if (y > yStart + 8 && y < yStart + 34) {
 
        if (x > xBase && x < xBase + 30) { sequence[selectedStepIndex].bpm -= 5; if(sequence[selectedStepIndex].bpm < 40) sequence[selectedStepIndex].bpm = 40; }
 
        if (x > xBase + 50 && x < xBase + 80) { sequence[selectedStepIndex].bpm += 5; if(sequence[selectedStepIndex].bpm > 250) sequence[selectedStepIndex].bpm = 250; }
 
+       if (isSequenceMode) soundManager.updateProgram(sequence);
+
+       drawEditor();
+
+     }
+
+     // Ramp (end tempo; the middle toggles linear / exponential)
+
+     yStart += 38;
+
+     if (y > yStart + 8 && y < yStart + 34) {
+
+       SequenceStep& step = sequence[selectedStepIndex];
+
+       int endBpm = step.isRamp() ? step.endBpm : step.bpm;
+
+       if (x > xBase && x < xBase + 30) { endBpm -= 5; if (endBpm < 40) endBpm = 40; }
+
+       if (x > xBase + 30 && x < xBase + 50 && step.isRamp()) step.curve = (step.curve == RAMP_LINEAR) ? RAMP_EXPONENTIAL : RAMP_LINEAR;
+
+       if (x > xBase + 50 && x < xBase + 80) { endBpm += 5; if (endBpm > 250) endBpm = 250; }
+
+       step.endBpm = (endBpm == step.bpm) ? 0 : endBpm; // Back to the start tempo: steady again
+
+       if (isSequenceMode) soundManager.updateProgram(sequence);
+
        drawEditor();
 
      }
@@ -1401,7 +1617,7 @@ void toggleEditor() {
 
     if (sequence.empty()) {
 
-      sequence.push_back({4, 4, 120});
+      sequence.push_back({4, 4, 120, 0, RAMP_LINEAR});
 
     }
 
@@ -1475,6 +1691,10 @@ void toggleMetronome() {
 
   currentBeat = 0; 
 
+  if (isPlaying) soundManager.startMetronome(bpm, beatsPerBar);
+
+  else soundManager.stopMetronome();
+
   drawButton(5); 
 
 }
@@ -1500,18 +1720,30 @@ void cycleTimeSig() {
   beatsPerBar = nextSig;
   
   currentBeat = 0; 
+  soundManager.setTempo(bpm, beatsPerBar);
+  soundManager.restartBar();
   updateTimeSig();
 }
 
 
 
-void increaseBPM10() { bpm += 10; if (bpm > 250) bpm = 250; updateBPM(); }
+void increaseBPM10() { bpm += 10; if (bpm > 250) bpm = 250; soundManager.setTempo(bpm, beatsPerBar); updateBPM(); }
+
+void decreaseBPM10() { bpm -= 10; if (bpm < 40) bpm = 40; soundManager.setTempo(bpm, beatsPerBar); updateBPM(); }
+
+void increaseBPM1() { bpm += 1; if (bpm > 250) bpm = 250; soundManager.setTempo(bpm, beatsPerBar); updateBPM(); }
 
-void decreaseBPM10() { bpm -= 10; if (bpm < 40) bpm = 40; updateBPM(); }
+void decreaseBPM1() { bpm -= 1; if (bpm < 40) bpm = 40; soundManager.setTempo(bpm, beatsPerBar); updateBPM(); }
 
-void increaseBPM1() { bpm += 1; if (bpm > 250) bpm = 250; updateBPM(); }
 
-void decreaseBPM1() { bpm -= 1; if (bpm < 40) bpm = 40; updateBPM(); }
+
+void toggleOutputChain() {
+
+  soundManager.setOutputChain(!soundManager.getOutputChain()); // Saved by SoundManager
+
+  updateVolume();
+
+}
 
 
 
@@ -1671,13 +1903,7 @@ void drawProgramSelect() {
 
 void refreshProgramList() {
 
-    programFiles = programManager.listPrograms();
-
-    selectedProgramIndex = -1;
-
-    programListScroll = 0;
-
-    drawProgramSelect();
+    storage.listPrograms(); // Drawn when the list arrives (handleStorageReply)
 
 }
 
@@ -1761,9 +1987,11 @@ void handleTouchProgramSelect(int x, int y) {
 
             sequence.clear();
 
-            sequence.push_back({4, 4, 120});
+            sequence.push_back({4, 4, 120, 0, RAMP_LINEAR});
+
+            currentProgramPath = "";
 
-            currentProgramPath = programManager.getNextProgramName(); // Pre-assign name
+            storage.newProgramName(); // Pre-assign name (shown once it arrives)
 
             currentScreen = SCREEN_EDITOR;
 
@@ -1781,23 +2009,7 @@ void handleTouchProgramSelect(int x, int y) {
 
             if (selectedProgramIndex >= 0 && selectedProgramIndex < programFiles.size()) {
 
-                String dbPath, bPath;
-
-                if (programManager.loadProgram(programFiles[selectedProgramIndex], sequence, dbPath, bPath)) {
-
-                    soundManager.loadSound(SOUND_DOWNBEAT, dbPath);
-
-                    soundManager.loadSound(SOUND_BEAT, bPath);
-
-                    currentProgramPath = programFiles[selectedProgramIndex];
-
-                    currentScreen = SCREEN_EDITOR;
-
-                    selectedStepIndex = 0;
-
-                    drawEditor();
-
-                }
+                storage.loadProgram(programFiles[selectedProgramIndex], TAG_EDIT);
 
             }
 
@@ -1815,8 +2027,12 @@ void handleTouchProgramSelect(int x, int y) {
 
                 isSequenceMode = false;
 
+                isPaused = false;
+
                 isPlaying = false;
 
+                soundManager.stopMetronome();
+
                 currentStepIndex = 0;
 
                 barsPlayedInStep = 0;
@@ -1831,72 +2047,170 @@ void handleTouchProgramSelect(int x, int y) {
 
                 if (selectedProgramIndex >= 0 && selectedProgramIndex < programFiles.size()) {
 
-                    String dbPath, bPath;
+                    storage.loadProgram(programFiles[selectedProgramIndex], TAG_PLAY);
 
-                    if (programManager.loadProgram(programFiles[selectedProgramIndex], sequence, dbPath, bPath)) {
+                }
 
-                        soundManager.loadSound(SOUND_DOWNBEAT, dbPath);
+            }
 
-                        soundManager.loadSound(SOUND_BEAT, bPath);
+            return;
 
-                        currentProgramPath = programFiles[selectedProgramIndex];
+        }
 
-                        if (!sequence.empty()) {
+        // DEL
 
-                            isSequenceMode = true;
+        if (x > 290 && x < 315) {
 
-                            isPlaying = true;
+            if (selectedProgramIndex >= 0 && selectedProgramIndex < programFiles.size()) {
 
-                            currentStepIndex = 0;
+                storage.deleteProgram(programFiles[selectedProgramIndex]); // List refreshed on the reply
 
-                            barsPlayedInStep = 0;
+            }
 
-                            currentBeat = 0;
+            return;
 
-                            beatsPerBar = sequence[0].beatsPerBar;
+        }
 
-                            bpm = sequence[0].bpm;
+    }
 
-                            
+}
 
-                            // Switch to Editor View for Playback
 
-                            currentScreen = SCREEN_EDITOR;
 
-                            selectedStepIndex = -1; // Deselect specific step so we just see the playback highlight
+// --- Storage Replies ---
 
-                            drawEditor();
+// File work runs on the storage task; this finishes what the touch handlers started.
 
-                        }
+void handleStorageReply(StorageMessage& reply) {
 
-                    }
+    switch (reply.type) {
 
-                }
+        case STORE_LIST_PROGRAMS:
+
+            programFiles.swap(*reply.list);
+
+            selectedProgramIndex = -1;
+
+            programListScroll = 0;
+
+            if (currentScreen == SCREEN_PROGRAM_SELECT) drawProgramSelect();
+
+            break;
+
+        case STORE_LIST_SOUNDS:
+
+            wavFiles.swap(*reply.list);
+
+            selectedSoundIndex = -1;
+
+            soundListScroll = 0;
+
+            if (currentScreen == SCREEN_SOUND_SELECT) drawSoundSelect();
+
+            break;
+
+        case STORE_LOAD:
+
+            if (!reply.ok) break;
+
+            sequence.swap(reply.program->sequence);
+
+            soundManager.loadSound(SOUND_DOWNBEAT, reply.program->dbPath);
+
+            soundManager.loadSound(SOUND_BEAT, reply.program->bPath);
+
+            currentProgramPath = reply.path;
+
+            if (reply.tag == TAG_EDIT) {
+
+                currentScreen = SCREEN_EDITOR;
+
+                selectedStepIndex = 0;
+
+                drawEditor();
+
+            } else if (reply.tag == TAG_PLAY && !sequence.empty()) {
+
+                if (!soundManager.startProgram(sequence, isLoopMode)) break;
+
+                isSequenceMode = true;
+
+                isPaused = false;
+
+                isPlaying = true;
+
+                currentStepIndex = 0;
+
+                barsPlayedInStep = 0;
+
+                currentBeat = 0;
+
+                beatsPerBar = sequence[0].beatsPerBar;
+
+                bpm = sequence[0].bpm;
+
+                // Switch to Editor View for Playback
+
+                currentScreen = SCREEN_EDITOR;
+
+                selectedStepIndex = -1; // Deselect specific step so we just see the playback highlight
+
+                drawEditor();
 
             }
 
-            return;
+            break;
 
-        }
+        case STORE_SAVE:
 
-        // DEL
+            if (reply.ok) {
 
-        if (x > 290 && x < 315) {
+                delay(500);
 
-            if (selectedProgramIndex >= 0 && selectedProgramIndex < programFiles.size()) {
+                // Go back to Program Select
 
-                programManager.deleteProgram(programFiles[selectedProgramIndex]);
+                currentScreen = SCREEN_PROGRAM_SELECT;
 
                 refreshProgramList();
 
+            } else {
+
+                tft.drawString("Error Saving!", 160, 140);
+
+                delay(1000);
+
+                drawEditor();
+
             }
 
-            return;
+            break;
 
-        }
+        case STORE_DELETE:
+
+            refreshProgramList();
+
+            break;
+
+        case STORE_NEW_NAME:
+
+            // Only if the editor still holds the unsaved new program
+
+            if (currentScreen == SCREEN_EDITOR && currentProgramPath.length() == 0) {
+
+                currentProgramPath = reply.path;
+
+                drawEditor();
+
+            }
+
+            break;
 
     }
 
+    delete reply.list;
+
+    delete reply.program;
+
 }
 
 
@@ -1973,6 +2287,16 @@ void setup() {
 
   programManager.begin();
 
+  // File access from here on goes through the storage task
+
+  storage.begin(programManager);
+
+  // UI (this loop task, core 1) outranks the loader and storage workers
+
+  vTaskPrioritySet(NULL, UI_TASK_PRIORITY);
+
+  TaskMonitor::add(TASK_UI, "ui", xTaskGetCurrentTaskHandle(), UI_TASK_STACK, 60);
+
   
 
   // Check if sounds are loaded, if not, go to Sound Select
@@ -1997,19 +2321,37 @@ void setup() {
 
 void loop() {
 
-  // Metronome Logic
+  int64_t start = esp_timer_get_time();
 
-  if (isPlaying) {
+  StorageMessage reply;
 
-    unsigned long interval = 60000 / bpm;
+  while (storage.poll(reply)) {
 
-    unsigned long currentMillis = millis();
+      handleStorageReply(reply);
 
-    
+  }
+
+  updateUi();
+
+  TaskMonitor::busy(TASK_UI, (uint32_t)(esp_timer_get_time() - start));
 
-    if (currentMillis - lastClickTime >= interval) {
+  TaskMonitor::poll();
 
-      lastClickTime = currentMillis;
+  delay(1); // Idle until the next tick instead of spinning
+
+}
+
+
+
+void updateUi() {
+
+  // Metronome Logic: follow the beats the mixer task has played.
+
+  // They are timed on its sample clock, so a slow redraw here no longer shifts the click.
+
+  BeatEvent played;
+
+  while (isPlaying && soundManager.pollBeat(played)) {
 
       
 
@@ -2027,109 +2369,99 @@ void loop() {
 
 
 
-      // Play Sound
-
-      if (currentBeat == 0) {
-
-          soundManager.playDownbeat();
+#ifdef AUDIO_ALLOC_DEBUG
 
-      } else {
+      // Steady-state playback must not touch the heap in the mixer task
 
-          soundManager.playBeat();
+      if (played.beatInBar == 0) {
 
-      }
+          Serial.printf("Heap ops: total %u, mixer task %u\n", AllocDebug::totalOperations(), AllocDebug::watchedTaskOperations());
 
-      
+          Serial.printf("Output chain: %u cycles per block (peak)\n", soundManager.takeOutputChainCycles());
 
-      // Advance Beat
+          Serial.printf("Output underruns: %u\n", soundManager.getUnderruns());
 
-      currentBeat++;
-
-      if (currentBeat >= beatsPerBar) {
+      }
 
-        currentBeat = 0;
+#endif
 
-        
 
-        // Sequence Logic
 
-        if (isSequenceMode && !sequence.empty()) {
+      // Sequence Logic: the mixer task walks the compiled program, the
 
-           barsPlayedInStep++;
+      // display only follows the step each beat came from
 
-           if (barsPlayedInStep >= sequence[currentStepIndex].bars) {
+      if (isSequenceMode) {
 
-              barsPlayedInStep = 0;
+         if (played.programEnd) {
 
-              currentStepIndex++;
+            // Stop
 
-              if (currentStepIndex >= sequence.size()) {
+            isSequenceMode = false;
 
-                 if (isLoopMode) {
+            isPaused = false;
 
-                    currentStepIndex = 0; // Loop
+            isPlaying = false;
 
-                 } else {
+            soundManager.stopMetronome();
 
-                    // Stop
+            currentStepIndex = 0;
 
-                    isSequenceMode = false;
+            barsPlayedInStep = 0;
 
-                    isPlaying = false;
+            currentBeat = 0;
 
-                    currentStepIndex = 0;
+            // Restore selection to first item when stopping automatically
 
-                    barsPlayedInStep = 0;
+            if (!sequence.empty()) selectedStepIndex = 0;
 
-                    currentBeat = 0;
+            if (currentScreen == SCREEN_EDITOR) drawEditor();
 
-                    // Restore selection to first item when stopping automatically
+            return; // Stop processing
 
-                    if (!sequence.empty()) selectedStepIndex = 0;
+         }
 
-                    if (currentScreen == SCREEN_EDITOR) drawEditor();
+         barsPlayedInStep = played.barInStep;
 
-                    return; // Stop processing
+         if (played.step != currentStepIndex && played.step < sequence.size()) {
 
-                 }
+            currentStepIndex = played.step;
 
-              }
+            beatsPerBar = sequence[currentStepIndex].beatsPerBar;
 
-              beatsPerBar = sequence[currentStepIndex].beatsPerBar;
+            bpm = sequence[currentStepIndex].bpm;
 
-              bpm = sequence[currentStepIndex].bpm;
+            // Auto-scroll to keep current step visible
 
-              
+            if (currentScreen == SCREEN_EDITOR) {
 
-              // Auto-scroll to keep current step visible
+                if (currentStepIndex < editorScroll) {
 
-              if (currentScreen == SCREEN_EDITOR) {
+                    editorScroll = currentStepIndex;
 
-                  if (currentStepIndex < editorScroll) {
+                } else if (currentStepIndex >= editorScroll + 5) {
 
-                      editorScroll = currentStepIndex;
+                    editorScroll = currentStepIndex - 4;
 
-                  } else if (currentStepIndex >= editorScroll + 5) {
+                }
 
-                      editorScroll = currentStepIndex - 4;
+                drawEditor();
 
-                  }
+            }
 
-                  drawEditor();
+         }
 
-              }
+      }
 
-           }
+      // Advance Beat
 
-        }
+      currentBeat = played.beatInBar + 1;
 
-      }
-
-    }
+      if (currentBeat >= beatsPerBar) currentBeat = 0;
 
   }
 
-  
+
 
   // Turn off visual beat
 
@@ -0,0 +1,86 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdarg.h>
+#ifndef ARDUINO
+#include <LittleFS.h>
+#include <dirent.h>
+#endif
+
+// Benchmarks run on the device (pio test -e cyd_test -f "bench/*") and on
+// the host (pio test -e native -f "bench/*"). Host numbers only compare
+// kernels with each other: the host shim counts its clock at 240 MHz.
+// Each suite also checks that what it measures still computes the right thing.
+namespace Bench {
+
+// Best of `rounds` runs, in CPU cycles (one run calls fn once)
+template <typename Fn>
+uint32_t cycles(Fn fn, int rounds = 5) {
+    uint32_t best = UINT32_MAX;
+    for (int r = 0; r < rounds; r++) {
+        uint32_t start = ESP.getCycleCount();
+        fn();
+        uint32_t spent = ESP.getCycleCount() - start;
+        if (spent < best) best = spent;
+    }
+    return best;
+}
+
+// Per second at the CPU clock, for `count` items taking `cycles`
+inline double perSecond(uint64_t count, uint32_t cycles) {
+    return cycles ? (double)count * ESP.getCpuFreqMHz() * 1e6 / cycles : 0;
+}
+
+// One result line in the test output
+inline void report(const char* format, ...) {
+    char text[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    TEST_MESSAGE(text);
+}
+
+// The same input every run (and on every platform)
+inline uint32_t noise(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state;
+}
+
+// The sounds in data/ in LittleFS. The host LittleFS starts out empty, so
+// they are copied there (pio test runs in the project directory); on the
+// device they come from uploadfs.
+inline void copyDataDir() {
+#ifndef ARDUINO
+    DIR* dir = opendir("data");
+    if (!dir) return;
+    while (struct dirent* entry = readdir(dir)) {
+        String name = entry->d_name;
+        if (!name.endsWith(".wav")) continue;
+        FILE* in = fopen(("data/" + name).c_str(), "rb");
+        File out = LittleFS.open("/" + name, FILE_WRITE);
+        uint8_t chunk[1024];
+        size_t n;
+        while (in && out && (n = fread(chunk, 1, sizeof(chunk), in)) > 0) out.write(chunk, n);
+        if (in) fclose(in);
+        out.close();
+    }
+    closedir(dir);
+#endif
+}
+
+} // namespace Bench
+
+// Entry point: the device runs the suite once after boot
+#ifdef ARDUINO
+#define BENCH_MAIN(run) \
+    void setup() { delay(2000); run(); } \
+    void loop() {}
+#else
+#define BENCH_MAIN(run) \
+    int main() { return run(); }
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+#include "../Bench.h"
+#include "SoundManager.h"
+#include <vector>
+
+// IMA-ADPCM storage (USE_ADPCM_STORAGE): what decoding costs the mixer per
+// sample, and how many of the sets in data/ the sound cache holds with and
+// without it. On the device, upload data/ first (pio run -t uploadfs).
+
+static Resampler resampler;
+
+void setUp() {}
+void tearDown() {}
+
+// A click-like test sound: decaying noise burst over a decaying 2 kHz tone
+static std::vector<int16_t> testSound(size_t frames) {
+    std::vector<int16_t> samples(frames);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < frames; i++) {
+        float envelope = expf(-(float)i / 2000);
+        float noise = (int16_t)(Bench::noise(seed) >> 16) / 32768.0f;
+        samples[i] = (int16_t)(envelope * (12000 * noise + 12000 * sinf(2 * M_PI * 2000 * i / AUDIO_SAMPLE_RATE)));
+    }
+    return samples;
+}
+
+void test_decode_cost() {
+    const size_t frames = 16384;
+    std::vector<int16_t> original = testSound(frames);
+    std::vector<uint8_t> encoded(Adpcm::bytesFor(frames));
+    Adpcm::Encoder encoder;
+    encoder.begin(encoded.data());
+    for (size_t i = 0; i < frames; i++) encoder.push(original[i]);
+    encoder.finish();
+
+    // In mixer blocks, carrying the state from one to the next like a voice does
+    std::vector<int16_t> decoded(frames);
+    uint32_t spent = Bench::cycles([&] {
+        Adpcm::State state;
+        for (size_t pos = 0; pos < frames; pos += AUDIO_BLOCK_FRAMES) {
+            Adpcm::decode(encoded.data(), pos, AUDIO_BLOCK_FRAMES, &decoded[pos], state);
+        }
+    });
+
+    double signal = 0, noise = 0;
+    for (size_t i = 0; i < frames; i++) {
+        double e = decoded[i] - original[i];
+        signal += (double)original[i] * original[i];
+        noise += e * e;
+    }
+    double snr = 10 * log10(signal / noise);
+    TEST_ASSERT_GREATER_THAN(15, (int)snr); // White noise is the worst case for ADPCM
+
+    Bench::report("decode: %.1f cycles per sample, %.2f%% of a core per voice at %u Hz, SNR %.1f dB",
+                  (double)spent / frames, 100.0 * spent / frames * AUDIO_SAMPLE_RATE / (ESP.getCpuFreqMHz() * 1e6),
+                  (unsigned)AUDIO_SAMPLE_RATE, snr);
+}
+
+// Frames the loader keeps of a file: mono, 44.1 kHz, silence trimmed
+// (ONSET_PREROLL_FRAMES kept before the first audible sample)
+static size_t storedFrames(const String& path) {
+    File file = LittleFS.open(path, FILE_READ);
+    WavInfo wav;
+    if (!file || WavParser::parse(file, wav) != WAV_OK) return 0;
+    std::vector<uint8_t> data(wav.dataSize);
+    file.seek(wav.dataOffset);
+    file.read(data.data(), data.size());
+    file.close();
+
+    std::vector<int16_t> mono;
+    for (uint32_t f = 0; f < wav.frames(); f++) {
+        const uint8_t* p = &data[f * wav.blockAlign];
+        int32_t sum = 0;
+        for (int c = 0; c < wav.channels; c++, p += wav.bitsPerSample / 8) {
+            sum += wav.bitsPerSample == 8 ? ((int32_t)p[0] - 128) << 8 : (int16_t)(p[0] | (p[1] << 8));
+        }
+        mono.push_back((int16_t)(sum / wav.channels));
+    }
+    if (resampler.configure(wav.sampleRate, AUDIO_SAMPLE_RATE)) {
+        std::vector<int16_t> converted;
+        int16_t out[RESAMPLER_MAX_OUTPUT * RESAMPLER_TAPS / 2];
+        for (int16_t s : mono) converted.insert(converted.end(), out, out + resampler.push(s, out));
+        converted.insert(converted.end(), out, out + resampler.flush(out));
+        mono.swap(converted);
+    }
+
+    size_t first = SIZE_MAX, last = 0;
+    for (size_t i = 0; i < mono.size(); i++) {
+        if (abs(mono[i]) < SILENCE_THRESHOLD) continue;
+        if (first == SIZE_MAX) first = i;
+        last = i;
+    }
+    if (first == SIZE_MAX) return 0;
+    return last + 1 - (first > ONSET_PREROLL_FRAMES ? first - ONSET_PREROLL_FRAMES : 0);
+}
+
+// How many sets fit into `budget` bytes, adding the given sizes in order
+static int setsThatFit(std::vector<size_t> sizes, size_t budget, bool smallestFirst) {
+    std::sort(sizes.begin(), sizes.end());
+    if (!smallestFirst) std::reverse(sizes.begin(), sizes.end());
+    int count = 0;
+    size_t used = 0;
+    for (size_t size : sizes) {
+        if (used + size > budget) break;
+        used += size;
+        count++;
+    }
+    return count;
+}
+
+void test_sets_in_the_sound_cache() {
+    LittleFS.begin(true);
+    Bench::copyDataDir();
+    std::vector<size_t> pcm, adpcm;
+    File root = LittleFS.open("/");
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        String name = file.name();
+        if (name.startsWith("/")) name = name.substring(1);
+        if (!name.endsWith("_Downbeat.wav")) continue;
+        String set = name.substring(0, name.length() - strlen("_Downbeat.wav"));
+        size_t frames[2] = {storedFrames("/" + set + "_Downbeat.wav"), storedFrames("/" + set + "_Beat.wav")};
+        if (!frames[0] || !frames[1]) continue;
+
+        pcm.push_back((frames[0] + frames[1]) * sizeof(int16_t));
+        adpcm.push_back(Adpcm::bytesFor(frames[0]) + Adpcm::bytesFor(frames[1]));
+        Bench::report("%-12s PCM %6.1f KB  ADPCM %5.1f KB", set.c_str(), pcm.back() / 1024.0, adpcm.back() / 1024.0);
+    }
+    if (pcm.empty()) TEST_IGNORE_MESSAGE("No sound sets in LittleFS (upload data/ first)");
+
+    size_t pcmTotal = 0, adpcmTotal = 0;
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcmTotal += pcm[i];
+        adpcmTotal += adpcm[i];
+        TEST_ASSERT_LESS_OR_EQUAL(pcm[i] / 3, adpcm[i]); // ~4:1 plus block headers
+    }
+    Bench::report("all %u sets: PCM %.1f KB, ADPCM %.1f KB", (unsigned)pcm.size(), pcmTotal / 1024.0, adpcmTotal / 1024.0);
+    // Largest sets first is the worst case, smallest first the best
+    Bench::report("SOUND_CACHE_BYTES (%u KB) fits %d-%d sets as PCM, %d-%d as ADPCM (SOUND_CACHE_SLOTS: at most %d)",
+                  SOUND_CACHE_BYTES / 1024,
+                  setsThatFit(pcm, SOUND_CACHE_BYTES, false), setsThatFit(pcm, SOUND_CACHE_BYTES, true),
+                  setsThatFit(adpcm, SOUND_CACHE_BYTES, false), setsThatFit(adpcm, SOUND_CACHE_BYTES, true),
+                  SOUND_CACHE_SLOTS / 2);
+}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_cost);
+    RUN_TEST(test_sets_in_the_sound_cache);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
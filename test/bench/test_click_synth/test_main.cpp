@@ -0,0 +1,55 @@
+#include "../Bench.h"
+#include "ClickSynth.h"
+#include "SoundManager.h"
+#include <vector>
+
+// Synthesized clicks are rendered by the mixer task: CPU cycles per output
+// block (AUDIO_BLOCK_FRAMES) for every preset, plain and accented, and the
+// share of a core that is at the output rate.
+
+void setUp() {}
+void tearDown() {}
+
+static void measure(const SynthPreset& preset, bool accent) {
+    size_t frames = ClickSynth::frames(preset, accent);
+    size_t blocks = (frames + AUDIO_BLOCK_FRAMES - 1) / AUDIO_BLOCK_FRAMES;
+    std::vector<int16_t> out(blocks * AUDIO_BLOCK_FRAMES);
+
+    // Block by block, like a voice in the mixer
+    uint32_t spent = Bench::cycles([&] {
+        ClickSynth::State state;
+        ClickSynth::start(preset, accent, state);
+        for (size_t b = 0; b < blocks; b++) ClickSynth::render(state, &out[b * AUDIO_BLOCK_FRAMES], AUDIO_BLOCK_FRAMES);
+    });
+
+    // Audible at the start, down to near silence at the end
+    int32_t first = 0, last = 0;
+    for (size_t i = 0; i < AUDIO_BLOCK_FRAMES; i++) first = max(first, (int32_t)abs(out[i]));
+    for (size_t i = frames - AUDIO_BLOCK_FRAMES; i < frames; i++) last = max(last, (int32_t)abs(out[i]));
+    TEST_ASSERT_GREATER_THAN_MESSAGE(4000, first, preset.name);
+    TEST_ASSERT_LESS_THAN_MESSAGE(first / 100, last, preset.name);
+
+    double perBlock = (double)spent / blocks;
+    double blocksPerSecond = (double)AUDIO_SAMPLE_RATE / AUDIO_BLOCK_FRAMES;
+    Bench::report("%-10s %-6s %4u blocks: %6.0f cycles per block, %.2f%% of a core while it plays",
+                  preset.name, accent ? "accent" : "plain", (unsigned)blocks, perBlock,
+                  100.0 * perBlock * blocksPerSecond / (ESP.getCpuFreqMHz() * 1e6));
+}
+
+void test_presets() {
+    TEST_ASSERT_GREATER_THAN(0, (int)ClickSynth::count());
+    for (size_t i = 0; i < ClickSynth::count(); i++) {
+        measure(ClickSynth::preset(i), false);
+        measure(ClickSynth::preset(i), true);
+    }
+    Bench::report("memory: %u bytes per preset (flash), %u bytes of state per voice",
+                  (unsigned)sizeof(SynthPreset), (unsigned)sizeof(ClickSynth::State));
+}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_presets);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
@@ -0,0 +1,140 @@
+#include "../Bench.h"
+#include "PcmConvert.h"
+#include "SoundManager.h"
+#include <vector>
+
+// WAV to mono 16-bit conversion in the loader: MB/s of WAV data per input
+// format with the per-format kernels, against the per-sample loop they
+// replaced, and the read + convert time of every file in data/ both ways.
+// On the device, upload data/ first (pio run -t uploadfs).
+
+#define OLD_READ_CHUNK 512 // What the per-sample loop read at a time
+
+void setUp() {}
+void tearDown() {}
+
+// The replaced loop: format branches and a store per sample
+static inline int32_t decodeOld(const uint8_t* p, uint16_t bytesPerSample) {
+    if (bytesPerSample == 1) return ((int32_t)p[0] - 128) << 8;
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static void convertOld(const uint8_t* src, size_t bytes, uint16_t bytesPerSample, uint16_t channels, int16_t* out) {
+    uint16_t frameBytes = bytesPerSample * channels;
+    for (size_t i = 0; i < bytes; i += frameBytes) {
+        int32_t val = decodeOld(src + i, bytesPerSample);
+        if (channels == 2) val = (val + decodeOld(src + i + bytesPerSample, bytesPerSample)) >> 1;
+        *out++ = (int16_t)val;
+    }
+}
+
+// Kernels run on CONVERT_BLOCK_FRAMES at a time, as in loadWavToBuffer
+static void convertNew(const uint8_t* src, size_t bytes, uint16_t bytesPerSample, uint16_t channels, int16_t* out) {
+    Pcm::Kernel convert = Pcm::pickKernel(bytesPerSample, channels);
+    uint16_t frameBytes = bytesPerSample * channels;
+    size_t frames = bytes / frameBytes;
+    for (size_t f = 0; f < frames; f += CONVERT_BLOCK_FRAMES) {
+        size_t n = frames - f;
+        if (n > CONVERT_BLOCK_FRAMES) n = CONVERT_BLOCK_FRAMES;
+        convert(src + f * frameBytes, n, out + f);
+    }
+}
+
+static void measure(uint16_t bits, uint16_t channels) {
+    const size_t bytes = 16384;
+    uint16_t bytesPerSample = bits / 8;
+    std::vector<uint8_t> wav(bytes);
+    uint32_t seed = bits * channels;
+    for (size_t i = 0; i < bytes; i++) wav[i] = (uint8_t)(Bench::noise(seed) >> 24);
+
+    size_t frames = bytes / (bytesPerSample * channels);
+    std::vector<int16_t> expected(frames), out(frames);
+    uint32_t oldCycles = Bench::cycles([&] { convertOld(wav.data(), bytes, bytesPerSample, channels, expected.data()); });
+    uint32_t newCycles = Bench::cycles([&] { convertNew(wav.data(), bytes, bytesPerSample, channels, out.data()); });
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), out.data(), frames);
+
+    Bench::report("%2u-bit %-6s: %7.1f MB/s (per-sample loop %7.1f MB/s)", (unsigned)bits, channels == 2 ? "stereo" : "mono",
+                  Bench::perSecond(bytes, newCycles) / 1e6, Bench::perSecond(bytes, oldCycles) / 1e6);
+}
+
+void test_16bit_mono() { measure(16, 1); }
+void test_16bit_stereo() { measure(16, 2); }
+void test_8bit_mono() { measure(8, 1); }
+void test_8bit_stereo() { measure(8, 2); }
+
+// Reads the data chunk of `path` in `chunk` sized pieces and converts it.
+// Microseconds, 0 if the file is not a WAV the loader reads. `convertUs` is
+// the part spent converting: what reading ahead on another task could hide
+// at most (min(read, convert)), if flash reads did not stop both cores.
+static uint32_t readAndConvert(const String& path, size_t chunk, bool kernels, std::vector<int16_t>& out, uint32_t& convertUs) {
+    static uint8_t buffer[WAV_READ_CHUNK];
+    uint32_t start = micros();
+    convertUs = 0;
+    File file = LittleFS.open(path, FILE_READ);
+    WavInfo wav;
+    if (!file || WavParser::parse(file, wav) != WAV_OK) return 0;
+
+    uint16_t bytesPerSample = wav.bitsPerSample / 8;
+    size_t readSize = chunk / wav.blockAlign * wav.blockAlign;
+    out.resize(wav.frames());
+    int16_t* dst = out.data();
+    file.seek(wav.dataOffset);
+    for (uint32_t done = 0; done < wav.dataSize;) {
+        size_t got = file.read(buffer, min((size_t)(wav.dataSize - done), readSize));
+        got -= got % wav.blockAlign;
+        if (got == 0) break;
+        uint32_t converting = micros();
+        if (kernels) convertNew(buffer, got, bytesPerSample, wav.channels, dst);
+        else convertOld(buffer, got, bytesPerSample, wav.channels, dst);
+        convertUs += micros() - converting;
+        dst += got / wav.blockAlign;
+        done += got;
+    }
+    file.close();
+    return max(micros() - start, 1UL);
+}
+
+void test_files_in_data() {
+    LittleFS.begin(true);
+    Bench::copyDataDir();
+
+    int files = 0;
+    uint32_t oldTotal = 0, newTotal = 0, convertTotal = 0, overlapTotal = 0;
+    File root = LittleFS.open("/");
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        String name = file.name();
+        if (name.startsWith("/")) name = name.substring(1);
+        if (!name.endsWith(".wav")) continue;
+
+        std::vector<int16_t> expected, out;
+        uint32_t oldConvertUs, convertUs;
+        uint32_t oldUs = readAndConvert("/" + name, OLD_READ_CHUNK, false, expected, oldConvertUs);
+        uint32_t newUs = readAndConvert("/" + name, WAV_READ_CHUNK, true, out, convertUs);
+        if (!oldUs) continue;
+        TEST_ASSERT_TRUE(expected == out);
+
+        uint32_t readUs = newUs > convertUs ? newUs - convertUs : 0;
+        Bench::report("%-24s %6u us: read %6u + convert %5u (was %6u us)", name.c_str(),
+                      (unsigned)newUs, (unsigned)readUs, (unsigned)convertUs, (unsigned)oldUs);
+        oldTotal += oldUs;
+        newTotal += newUs;
+        convertTotal += convertUs;
+        overlapTotal += min(readUs, convertUs);
+        files++;
+    }
+    if (!files) TEST_IGNORE_MESSAGE("No WAV files in LittleFS (upload data/ first)");
+    Bench::report("all %d files: %u us (was %u us), converting %u us; overlapped reads would save at most %u us",
+                  files, (unsigned)newTotal, (unsigned)oldTotal, (unsigned)convertTotal, (unsigned)overlapTotal);
+}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_16bit_mono);
+    RUN_TEST(test_16bit_stereo);
+    RUN_TEST(test_8bit_mono);
+    RUN_TEST(test_8bit_stereo);
+    RUN_TEST(test_files_in_data);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
@@ -0,0 +1,93 @@
+#include "../Bench.h"
+#include "GainStage.h"
+#include "SoundManager.h"
+#include <vector>
+
+// The master gain stage after the mixer: Gain::Ramp holding a level and
+// gliding to a new one, against the (val * volume) / 255 loop it replaced.
+// Cycles per output block (AUDIO_BLOCK_FRAMES).
+
+static const size_t blocks = 64;
+static const size_t frames = blocks * AUDIO_BLOCK_FRAMES;
+
+void setUp() {}
+void tearDown() {}
+
+// The replaced loop: linear volume, one divide per sample
+static void applyOld(const int32_t* in, int16_t* out, size_t n, int32_t vol) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t val = (in[i] * vol) / 255;
+        if (val > 32767) val = 32767;
+        else if (val < -32768) val = -32768;
+        out[i] = (int16_t)val;
+    }
+}
+
+// Summed voices: up to twice full scale, so saturation is exercised
+static std::vector<int32_t> mixedVoices() {
+    std::vector<int32_t> mix(frames);
+    uint32_t seed = 7;
+    for (size_t i = 0; i < frames; i++) mix[i] = (int32_t)(Bench::noise(seed) >> 16) - 32768 + (int32_t)(Bench::noise(seed) >> 16) - 32768;
+    return mix;
+}
+
+static double perBlock(uint32_t cycles) {
+    return (double)cycles / blocks;
+}
+
+void test_gain_stage() {
+    std::vector<int32_t> mix = mixedVoices();
+    std::vector<int16_t> expected(frames), out(frames);
+
+    volatile int32_t volume = 255; // Read at run time, as the mixer did
+    uint32_t oldCycles = Bench::cycles([&] {
+        for (size_t b = 0; b < frames; b += AUDIO_BLOCK_FRAMES) applyOld(&mix[b], &expected[b], AUDIO_BLOCK_FRAMES, volume);
+    });
+
+    // Holding unity gives what the old loop gave at full volume
+    Gain::Ramp held;
+    held.setTarget(GAIN_UNITY);
+    held.apply(mix.data(), out.data(), AUDIO_BLOCK_FRAMES); // Reaches the target
+    uint32_t heldCycles = Bench::cycles([&] {
+        for (size_t b = 0; b < frames; b += AUDIO_BLOCK_FRAMES) held.apply(&mix[b], &out[b], AUDIO_BLOCK_FRAMES);
+    });
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected.data(), out.data(), frames);
+
+    // Every block glides to a new level (the worst case: volume held down)
+    Gain::Ramp ramping;
+    uint32_t rampCycles = Bench::cycles([&] {
+        for (size_t b = 0; b < frames; b += AUDIO_BLOCK_FRAMES) {
+            ramping.setTarget(Gain::fromLevel((b / AUDIO_BLOCK_FRAMES & 1) ? 255 : 128));
+            ramping.apply(&mix[b], &out[b], AUDIO_BLOCK_FRAMES);
+        }
+    });
+
+    Bench::report("per block: held %.0f cycles, ramping %.0f cycles, old divide loop %.0f cycles",
+                  perBlock(heldCycles), perBlock(rampCycles), perBlock(oldCycles));
+}
+
+// A ramp moves a little every sample: no step larger than the level change
+// spread over the block, so a volume change does not click
+void test_ramp_is_smooth() {
+    std::vector<int32_t> dc(2 * AUDIO_BLOCK_FRAMES, 16000);
+    std::vector<int16_t> out(2 * AUDIO_BLOCK_FRAMES);
+    Gain::Ramp ramp;
+    ramp.setTarget(GAIN_UNITY);
+    ramp.apply(dc.data(), out.data(), AUDIO_BLOCK_FRAMES);
+    for (size_t i = 1; i < AUDIO_BLOCK_FRAMES; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL(16000 / AUDIO_BLOCK_FRAMES + 2, abs(out[i] - out[i - 1]));
+    }
+    TEST_ASSERT_INT_WITHIN(1, 16000, out[AUDIO_BLOCK_FRAMES - 1]);
+
+    ramp.apply(dc.data(), &out[AUDIO_BLOCK_FRAMES], AUDIO_BLOCK_FRAMES);
+    TEST_ASSERT_EQUAL_INT16(16000, out[2 * AUDIO_BLOCK_FRAMES - 1]);
+}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_gain_stage);
+    RUN_TEST(test_ramp_is_smooth);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
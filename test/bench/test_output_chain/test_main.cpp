@@ -0,0 +1,86 @@
+#include "../Bench.h"
+#include "OutputChain.h"
+#include "SoundManager.h"
+#include <vector>
+
+// The speaker EQ + limiter after the voice mix: CPU cycles per output block
+// (AUDIO_BLOCK_FRAMES), and what it does to a click that would clip.
+
+static const size_t blocks = 64;
+static const size_t frames = blocks * AUDIO_BLOCK_FRAMES;
+static OutputChain chain; // Delay line and filter state, not on the test task's stack
+
+void setUp() {}
+void tearDown() {}
+
+// Two loud voices on top of each other: decaying 1.5 kHz tone plus noise,
+// peaking well above 16-bit full scale, once every 16 blocks
+static std::vector<int32_t> loudClicks() {
+    std::vector<int32_t> mix(frames);
+    uint32_t seed = 3;
+    for (size_t i = 0; i < frames; i++) {
+        size_t t = i % (16 * AUDIO_BLOCK_FRAMES);
+        float envelope = expf(-(float)t / 300);
+        float noise = (int16_t)(Bench::noise(seed) >> 16) / 32768.0f;
+        mix[i] = (int32_t)(envelope * (40000 * sinf(2 * M_PI * 1500 * t / AUDIO_SAMPLE_RATE) + 15000 * noise));
+    }
+    return mix;
+}
+
+static double rmsDb(const int32_t* samples, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) sum += (double)samples[i] * samples[i];
+    return 10 * log10(sum / n);
+}
+
+void test_output_chain() {
+    std::vector<int32_t> mix = loudClicks();
+    std::vector<int32_t> block(frames);
+
+    uint32_t spent = Bench::cycles([&] {
+        block = mix;
+        chain.reset();
+        for (size_t b = 0; b < frames; b += AUDIO_BLOCK_FRAMES) chain.process(&block[b], AUDIO_BLOCK_FRAMES);
+    });
+
+    // Never past the ceiling, where the raw mix would clip at 16 bits
+    int32_t peak = 0;
+    for (int32_t s : block) peak = max(peak, (int32_t)abs(s));
+    TEST_ASSERT_LESS_OR_EQUAL(LIMITER_CEILING, peak);
+
+    // Level against the raw mix turned down until it no longer clips
+    // (what the volume had to do without the chain)
+    int32_t rawPeak = 0;
+    for (int32_t s : mix) rawPeak = max(rawPeak, (int32_t)abs(s));
+    std::vector<int32_t> turnedDown(frames);
+    for (size_t i = 0; i < frames; i++) turnedDown[i] = (int32_t)((int64_t)mix[i] * 32767 / rawPeak);
+    double change = rmsDb(&block[LIMITER_LOOKAHEAD], frames - LIMITER_LOOKAHEAD) - rmsDb(turnedDown.data(), frames - LIMITER_LOOKAHEAD);
+
+    double perBlock = (double)spent / blocks;
+    Bench::report("%.0f cycles per %u-frame block, %.2f%% of a core at %u Hz",
+                  perBlock, (unsigned)AUDIO_BLOCK_FRAMES,
+                  100.0 * perBlock * AUDIO_SAMPLE_RATE / AUDIO_BLOCK_FRAMES / (ESP.getCpuFreqMHz() * 1e6), (unsigned)AUDIO_SAMPLE_RATE);
+    Bench::report("loud clicks: peak %d (ceiling %d), RMS %+.1f dB against the mix turned down to full scale", (int)peak, LIMITER_CEILING, change);
+}
+
+// Quiet input passes below the limiter: only the EQ and make-up gain apply
+void test_quiet_input_is_not_limited() {
+    std::vector<int32_t> block(frames);
+    for (size_t i = 0; i < frames; i++) block[i] = (int32_t)(2000 * sinf(2 * M_PI * 2000 * i / AUDIO_SAMPLE_RATE));
+    chain.reset();
+    for (size_t b = 0; b < frames; b += AUDIO_BLOCK_FRAMES) chain.process(&block[b], AUDIO_BLOCK_FRAMES);
+
+    int32_t peak = 0;
+    for (size_t i = frames / 2; i < frames; i++) peak = max(peak, (int32_t)abs(block[i]));
+    TEST_ASSERT_GREATER_THAN(2000, peak); // Louder, not held down
+    TEST_ASSERT_LESS_THAN(LIMITER_CEILING / 2, peak);
+}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_output_chain);
+    RUN_TEST(test_quiet_input_is_not_limited);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
@@ -0,0 +1,63 @@
+#include "../Bench.h"
+#include "Resampler.h"
+#include <vector>
+
+// Load-time rate conversion to 44.1 kHz: input and output samples per second
+// for the rates WAV files come in, and what one output sample costs
+
+static const uint32_t outRate = 44100;
+static Resampler resampler; // 2 KB of taps, not on the test task's stack
+
+void setUp() {}
+void tearDown() {}
+
+// A quarter second of a 1 kHz tone at `rate`, half scale (small enough for the device heap)
+static std::vector<int16_t> tone(uint32_t rate) {
+    std::vector<int16_t> samples(rate / 4);
+    for (uint32_t i = 0; i < samples.size(); i++) samples[i] = (int16_t)(16384 * sin(2 * M_PI * 1000.0 * i / rate));
+    return samples;
+}
+
+// Converts `in` the way loadWavToBuffer does (push per sample, then flush)
+static size_t convert(const std::vector<int16_t>& in, uint32_t rate, std::vector<int16_t>& out) {
+    out.resize((size_t)((uint64_t)in.size() * outRate / rate) + RESAMPLER_MAX_OUTPUT * RESAMPLER_TAPS);
+    resampler.configure(rate, outRate);
+    size_t n = 0;
+    for (size_t i = 0; i < in.size(); i++) n += resampler.push(in[i], &out[n]);
+    n += resampler.flush(&out[n]);
+    return n;
+}
+
+static void measure(uint32_t rate) {
+    std::vector<int16_t> in = tone(rate);
+    std::vector<int16_t> out;
+    size_t produced = 0;
+    uint32_t spent = Bench::cycles([&] { produced = convert(in, rate, out); });
+
+    // Length: a quarter second plus the filter tail
+    TEST_ASSERT_INT_WITHIN(RESAMPLER_TAPS * outRate / rate + 1, outRate / 4, produced);
+    // Level: the 1 kHz tone passes unchanged (within 0.5 dB), away from the edges
+    int32_t peak = 0;
+    for (size_t i = outRate / 16; i < outRate * 3 / 16; i++) peak = max(peak, (int32_t)abs(out[i]));
+    TEST_ASSERT_INT_WITHIN(16384 * 6 / 100, 16384, peak);
+
+    Bench::report("%5u -> %u Hz: %6.2f M in/s, %6.2f M out/s, %5.1f cycles per output sample",
+                  (unsigned)rate, (unsigned)outRate, Bench::perSecond(in.size(), spent) / 1e6,
+                  Bench::perSecond(produced, spent) / 1e6, (double)spent / produced);
+}
+
+void test_from_8000() { measure(8000); }
+void test_from_22050() { measure(22050); }
+void test_from_32000() { measure(32000); }
+void test_from_48000() { measure(48000); }
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_from_8000);
+    RUN_TEST(test_from_22050);
+    RUN_TEST(test_from_32000);
+    RUN_TEST(test_from_48000);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
@@ -0,0 +1,127 @@
+#include "../Bench.h"
+#include "WavParser.h"
+#include <LittleFS.h>
+#include <vector>
+
+// Finding the audio data of a WAV on LittleFS: WavParser (one open, one
+// bounds-checked chunk walk) against the two-open path it replaced
+// (isValidWav read a fixed 44-byte header, then loadWavToBuffer opened the
+// file again and walked the chunks one field at a time).
+// On the device, upload data/ first (pio run -t uploadfs).
+
+void setUp() {}
+void tearDown() {}
+
+struct DataChunk {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+// isValidWav before WavParser
+static bool validOld(const String& path) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    if (file.size() < 44) { file.close(); return false; }
+    uint8_t header[44];
+    file.read(header, 44);
+    file.close();
+    if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) return false;
+    uint16_t fmtCode = (uint16_t)(header[20] | (header[21] << 8));
+    uint16_t channels = (uint16_t)(header[22] | (header[23] << 8));
+    uint32_t sampleRate = (uint32_t)(header[24] | (header[25] << 8) | (header[26] << 16) | ((uint32_t)header[27] << 24));
+    uint16_t bits = (uint16_t)(header[34] | (header[35] << 8));
+    return fmtCode == 1 && channels <= 2 && sampleRate <= WAV_MAX_RATE && sampleRate >= RESAMPLER_MIN_RATE && bits <= 16;
+}
+
+// The chunk walk at the start of loadWavToBuffer before WavParser
+static bool findDataOld(const String& path, DataChunk& data) {
+    if (!LittleFS.exists(path)) return false;
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    file.seek(12);
+    bool foundFmt = false;
+    while (file.available()) {
+        char chunkID[4];
+        file.read((uint8_t*)chunkID, 4);
+        uint32_t chunkSize;
+        file.read((uint8_t*)&chunkSize, 4);
+        if (memcmp(chunkID, "fmt ", 4) == 0) {
+            uint16_t fmtCode; file.read((uint8_t*)&fmtCode, 2);
+            uint16_t channels; file.read((uint8_t*)&channels, 2);
+            uint32_t sampleRate; file.read((uint8_t*)&sampleRate, 4);
+            uint32_t byteRate; file.read((uint8_t*)&byteRate, 4);
+            uint16_t blockAlign; file.read((uint8_t*)&blockAlign, 2);
+            uint16_t bitsPerSample; file.read((uint8_t*)&bitsPerSample, 2);
+            if (chunkSize > 16) file.seek(file.position() + chunkSize - 16);
+            foundFmt = true;
+        } else if (memcmp(chunkID, "data", 4) == 0) {
+            if (!foundFmt) break;
+            data.offset = file.position();
+            data.size = chunkSize;
+            file.close();
+            return true;
+        } else {
+            file.seek(file.position() + chunkSize);
+        }
+    }
+    file.close();
+    return false;
+}
+
+static bool findDataNew(const String& path, DataChunk& data) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    WavInfo wav;
+    WavStatus status = WavParser::parse(file, wav);
+    file.close();
+    data.offset = wav.dataOffset;
+    data.size = wav.dataSize;
+    return status == WAV_OK;
+}
+
+static std::vector<String> wavFiles() {
+    std::vector<String> paths;
+    File root = LittleFS.open("/");
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        String name = file.name();
+        if (name.startsWith("/")) name = name.substring(1);
+        if (name.endsWith(".wav")) paths.push_back("/" + name);
+    }
+    return paths;
+}
+
+void test_files_in_data() {
+    LittleFS.begin(true);
+    Bench::copyDataDir();
+    std::vector<String> paths = wavFiles();
+    if (paths.empty()) TEST_IGNORE_MESSAGE("No WAV files in LittleFS (upload data/ first)");
+
+    // The shipped files are plain 44-byte-header WAVs: both find the same data
+    for (const String& path : paths) {
+        DataChunk old, found;
+        TEST_ASSERT_TRUE_MESSAGE(validOld(path) && findDataOld(path, old), path.c_str());
+        TEST_ASSERT_TRUE_MESSAGE(findDataNew(path, found), path.c_str());
+        TEST_ASSERT_EQUAL_UINT32(old.offset, found.offset);
+        TEST_ASSERT_EQUAL_UINT32(old.size, found.size);
+    }
+
+    DataChunk data;
+    uint32_t oldCycles = Bench::cycles([&] {
+        for (const String& path : paths) validOld(path) && findDataOld(path, data);
+    });
+    uint32_t newCycles = Bench::cycles([&] {
+        for (const String& path : paths) findDataNew(path, data);
+    });
+    double oldUs = (double)oldCycles / ESP.getCpuFreqMHz() / paths.size();
+    double newUs = (double)newCycles / ESP.getCpuFreqMHz() / paths.size();
+    Bench::report("%u files: WavParser %.1f us per file, two-open path %.1f us per file (%.1fx)",
+                  (unsigned)paths.size(), newUs, oldUs, oldUs / newUs);
+}
+
+static int runBenchmarks() {
+    UNITY_BEGIN();
+    RUN_TEST(test_files_in_data);
+    return UNITY_END();
+}
+
+BENCH_MAIN(runBenchmarks)
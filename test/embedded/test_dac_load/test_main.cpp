@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <stdarg.h>
+#include "SoundManager.h"
+
+// CPU time the audio output takes, per core: a counting task at idle
+// priority runs on each core, and what it counts less than before the audio
+// started is time spent elsewhere (mixer, ISRs, driver). Reports the built
+// backend, stopped and playing. Run once per internal DAC path and compare:
+//   pio test -e cyd_test_dac -f embedded/test_dac_load        (I2S DMA)
+//   pio test -e cyd_test_dac_timer -f embedded/test_dac_load  (timer ISR)
+
+#define MEASURE_MS 3000
+
+static volatile uint32_t spins[2];
+static volatile bool counting = false;
+
+static void countSpins(void* param) {
+    volatile uint32_t* count = (volatile uint32_t*)param;
+    while (true) {
+        if (counting) (*count)++;
+    }
+}
+
+// Spins counted on each core over MEASURE_MS
+static void measure(uint32_t counted[2]) {
+    spins[0] = spins[1] = 0;
+    counting = true;
+    delay(MEASURE_MS);
+    counting = false;
+    counted[0] = spins[0];
+    counted[1] = spins[1];
+}
+
+static void report(const char* format, ...) {
+    char text[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    TEST_MESSAGE(text);
+}
+
+static float busy(uint32_t counted, uint32_t idle) {
+    return idle ? 100.0f * (1.0f - (float)counted / idle) : 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_output_load() {
+    // The idle task keeps its share of each core in every run, so only the
+    // ratio to the run without audio counts
+    xTaskCreatePinnedToCore(countSpins, "spin0", 1024, (void*)&spins[0], tskIDLE_PRIORITY, nullptr, 0);
+    xTaskCreatePinnedToCore(countSpins, "spin1", 1024, (void*)&spins[1], tskIDLE_PRIORITY, nullptr, 1);
+    uint32_t idle[2], stopped[2], playing[2];
+    measure(idle);
+
+    TEST_ASSERT_TRUE(soundManager.begin());
+    delay(1000); // Output queue full, loader idle
+    measure(stopped);
+    soundManager.startMetronome(240, 4);
+    delay(500);
+    uint32_t underrunsBefore = soundManager.getUnderruns();
+    measure(playing);
+    uint32_t underruns = soundManager.getUnderruns() - underrunsBefore;
+    soundManager.stopMetronome();
+
+#if defined(USE_DAC_TIMER_AUDIO)
+    const char* backend = "DAC, timer ISR";
+#elif defined(USE_I2S_AUDIO) && !defined(USE_DAC_AUDIO)
+    const char* backend = "external I2S";
+#else
+    const char* backend = "DAC, I2S DMA";
+#endif
+    report("%s: stopped core 0 %.1f%%, core 1 %.1f%%", backend, busy(stopped[0], idle[0]), busy(stopped[1], idle[1]));
+    report("%s: playing core 0 %.1f%%, core 1 %.1f%%, underruns %u", backend,
+           busy(playing[0], idle[0]), busy(playing[1], idle[1]), (unsigned)underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, underruns);
+}
+
+void setup() {
+    delay(2000); // Serial monitor attached
+    UNITY_BEGIN();
+    RUN_TEST(test_output_load);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include "SoundManager.h"
+#include "ProgramManager.h"
+
+// Flash writes during playback: programs are saved and deleted (and a sound
+// level, which goes to Preferences) in a tight loop while the metronome
+// plays. While flash is written no task runs, only the queued DMA audio
+// plays on, so the output must never run dry (underruns stay 0). Also
+// reports the longest stall seen against the queue (AUDIO_DMA_BUFFERS, sized
+// for the datasheet's worst sector erase, FLASH_ERASE_MAX_MS).
+// Run: pio test -e cyd_test -f embedded/test_flash_stress
+
+#define STRESS_ROUNDS 200
+
+static ProgramManager programs;
+static volatile bool watching = false;
+static volatile int64_t longestStall = 0; // us
+
+// Wakes every tick on the mixer's core: a longer gap is time no task could run
+static void watchStalls(void*) {
+    int64_t last = esp_timer_get_time();
+    while (watching) {
+        vTaskDelay(1);
+        int64_t now = esp_timer_get_time();
+        if (now - last > longestStall) longestStall = now - last;
+        last = now;
+    }
+    vTaskDelete(nullptr);
+}
+
+static void report(const char* format, ...) {
+    char text[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    TEST_MESSAGE(text);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_save_and_delete_while_playing() {
+    TEST_ASSERT_TRUE(soundManager.begin());
+    programs.begin();
+    std::vector<SequenceStep> sequence = {{4, 4, 120, 0, RAMP_LINEAR}, {8, 3, 90, 140, RAMP_EXPONENTIAL}, {2, 7, 200, 0, RAMP_LINEAR}};
+
+    soundManager.startMetronome(240, 4);
+    delay(1000); // Output queue full, loader idle
+    uint32_t underrunsBefore = soundManager.getUnderruns();
+    watching = true;
+    xTaskCreatePinnedToCore(watchStalls, "stalls", 2048, nullptr, 1, nullptr, AUDIO_TASK_CORE);
+
+    int64_t longestSave = 0, longestDelete = 0, longestLevel = 0;
+    for (int i = 0; i < STRESS_ROUNDS; i++) {
+        String path = "/programs/Stress_" + String(i % 4) + ".txt";
+        int64_t start = esp_timer_get_time();
+        TEST_ASSERT_TRUE(programs.saveProgram(path, sequence, "/Metro_Downbeat.wav", "/Metro_Beat.wav"));
+        int64_t saved = esp_timer_get_time();
+        programs.deleteProgram(path);
+        int64_t deleted = esp_timer_get_time();
+        soundManager.setLevel(SOUND_BEAT, (i & 1) ? 236 : 255);
+        int64_t leveled = esp_timer_get_time();
+
+        longestSave = max(longestSave, saved - start);
+        longestDelete = max(longestDelete, deleted - saved);
+        longestLevel = max(longestLevel, leveled - deleted);
+    }
+    delay(100); // Underruns are counted on the mixer's next writes
+    watching = false;
+    uint32_t underruns = soundManager.getUnderruns() - underrunsBefore;
+    soundManager.stopMetronome();
+    soundManager.setLevel(SOUND_BEAT, 255);
+
+    report("%d rounds: longest save %.1f ms, delete %.1f ms, level %.1f ms", STRESS_ROUNDS,
+           longestSave / 1000.0, longestDelete / 1000.0, longestLevel / 1000.0);
+    report("longest stall %.1f ms, output queue %.1f ms (sized for FLASH_ERASE_MAX_MS %d), underruns %u",
+           longestStall / 1000.0, AUDIO_OUTPUT_LATENCY * 1000.0 / AUDIO_SAMPLE_RATE, FLASH_ERASE_MAX_MS, (unsigned)underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, underruns);
+    TEST_ASSERT_LESS_THAN(AUDIO_OUTPUT_LATENCY * 1000000LL / AUDIO_SAMPLE_RATE, longestStall);
+}
+
+void setup() {
+    delay(2000); // Serial monitor attached
+    UNITY_BEGIN();
+    RUN_TEST(test_save_and_delete_while_playing);
+    UNITY_END();
+}
+
+void loop() {}
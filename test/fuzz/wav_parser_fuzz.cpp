@@ -0,0 +1,109 @@
+#include "WavParser.h"
+
+// Fuzz target for WavParser (every WAV on LittleFS goes through it).
+// Not a pio test: build it by hand from the project directory.
+//
+// libFuzzer (clang), seeded with the corpus:
+//   clang++ -std=gnu++11 -g -O1 -fsanitize=fuzzer,address,undefined \
+//     -Ilib/HostShim/src -Isrc test/fuzz/wav_parser_fuzz.cpp src/WavParser.cpp \
+//     lib/HostShim/src/*.cpp lib/HostShim/src/freertos/*.cpp -pthread -o wav_fuzz
+//   ./wav_fuzz test/fuzz/corpus
+//
+// Without clang, -DWAV_FUZZ_STANDALONE builds a replay and mutation driver:
+//   g++ -std=gnu++11 -g -O1 -fsanitize=address,undefined -DWAV_FUZZ_STANDALONE ... -o wav_fuzz
+//   ./wav_fuzz test/fuzz/corpus data [mutations per input]
+//
+// A crash or a trap is a bug; add the input that caused it to corpus/.
+
+// What the loader relies on when parse() says WAV_OK
+static void checkAccepted(const WavInfo& info, size_t size) {
+    if (info.blockAlign == 0 || info.dataSize == 0) __builtin_trap();
+    if (info.dataSize % info.blockAlign != 0) __builtin_trap();
+    if ((uint64_t)info.dataOffset + info.dataSize > size) __builtin_trap();
+    if (info.channels < 1 || info.channels > 2) __builtin_trap();
+    if (info.bitsPerSample != 8 && info.bitsPerSample != 16) __builtin_trap();
+    if (info.blockAlign != info.channels * info.bitsPerSample / 8) __builtin_trap();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    WavInfo info;
+    WavStatus status = WavParser::parse(data, size, info);
+    if (status == WAV_OK) checkAccepted(info, size);
+    WavParser::describe(status);
+    return 0;
+}
+
+#ifdef WAV_FUZZ_STANDALONE
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return bytes;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+    fclose(file);
+    return bytes;
+}
+
+static void addInputs(const std::string& path, std::vector<std::vector<uint8_t>>& inputs) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return;
+    if (!S_ISDIR(info.st_mode)) {
+        inputs.push_back(readFile(path));
+        return;
+    }
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') addInputs(path + "/" + entry->d_name, inputs);
+    }
+    closedir(dir);
+}
+
+// Byte flips, chunk size fields set to edge values, and truncation
+static void mutate(std::vector<uint8_t>& bytes, uint32_t& seed) {
+    auto next = [&seed] { return seed = seed * 1664525u + 1013904223u; };
+    if (bytes.empty()) return;
+    int edits = 1 + next() % 4;
+    for (int i = 0; i < edits; i++) {
+        size_t at = next() % bytes.size();
+        switch (next() % 4) {
+            case 0: bytes[at] = (uint8_t)(next() >> 24); break;
+            case 1: bytes[at] = 0; break;
+            case 2: bytes[at] = 0xFF; break;
+            case 3: bytes.resize(at); if (bytes.empty()) return; break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file or dir>... [mutations per input]\n", argv[0]);
+        return 2;
+    }
+    std::vector<std::vector<uint8_t>> inputs;
+    long mutations = 10000;
+    for (int i = 1; i < argc; i++) {
+        char* end;
+        long n = strtol(argv[i], &end, 10);
+        if (*end == '\0') mutations = n;
+        else addInputs(argv[i], inputs);
+    }
+
+    uint32_t seed = 1;
+    for (const std::vector<uint8_t>& input : inputs) {
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        for (long m = 0; m < mutations; m++) {
+            std::vector<uint8_t> bytes = input;
+            mutate(bytes, seed);
+            LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+        }
+    }
+    printf("%u inputs, %ld mutations each: no crashes\n", (unsigned)inputs.size(), mutations);
+    return 0;
+}
+#endif
@@ -0,0 +1,84 @@
+#ifndef AUDIOCAPTURE_H
+#define AUDIOCAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include "SoundManager.h"
+
+// Records what the mixer task sends to the NullBackend, for the native tests.
+// Only one recording at a time: start() may only be called while idle.
+namespace AudioCapture {
+
+static std::vector<int16_t> samples;
+static size_t wanted = 0;
+static std::atomic<bool> recording{false};
+
+// NullBackend::capture, runs on the mixer task
+static void onBlock(const int16_t* block, size_t frames) {
+    if (!recording.load(std::memory_order_acquire)) return;
+    size_t n = wanted - samples.size();
+    if (n > frames) n = frames;
+    samples.insert(samples.end(), block, block + n);
+    if (samples.size() >= wanted) recording.store(false, std::memory_order_release);
+}
+
+// Renders as fast as the host can from here on, with every block passing onBlock()
+inline bool begin() {
+    NullBackend::paced = false;
+    NullBackend::capture = onBlock;
+    LittleFS.begin(true);
+    LittleFS.format(); // Every test binary starts from an empty file system
+    return soundManager.begin();
+}
+
+// Records the next `frames` samples. Call wait() before reading `samples`.
+inline void start(size_t frames) {
+    samples.clear();
+    samples.reserve(frames);
+    wanted = frames;
+    recording.store(true, std::memory_order_release);
+}
+
+inline bool wait(uint32_t timeoutMs = 60000) {
+    uint32_t begin = millis();
+    while (recording.load(std::memory_order_acquire)) {
+        if (millis() - begin > timeoutMs) return false;
+        delay(1);
+    }
+    return true;
+}
+
+inline std::vector<int16_t>& record(size_t frames) {
+    start(frames);
+    wait();
+    return samples;
+}
+
+// Sample indices where a click starts: the first sample at or above
+// `threshold` after at least `quiet` samples below it. Unless the recording
+// started before anything played (`startsQuiet`), it may start inside a
+// click, which then does not count.
+inline std::vector<size_t> onsets(const std::vector<int16_t>& audio, bool startsQuiet = false, int threshold = 2000, size_t quiet = 2000) {
+    std::vector<size_t> found;
+    size_t below = startsQuiet ? quiet : 0;
+    for (size_t i = 0; i < audio.size(); i++) {
+        if (abs(audio[i]) < threshold) {
+            below++;
+            continue;
+        }
+        if (below >= quiet) found.push_back(i);
+        below = 0;
+    }
+    return found;
+}
+
+inline int32_t peak(const std::vector<int16_t>& audio, size_t from = 0) {
+    int32_t level = 0;
+    for (size_t i = from; i < audio.size(); i++) level = max(level, (int32_t)abs(audio[i]));
+    return level;
+}
+
+} // namespace AudioCapture
+
+#endif
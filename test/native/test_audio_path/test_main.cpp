@@ -0,0 +1,53 @@
+#include <unity.h>
+#include "../AudioCapture.h"
+
+// The whole audio path on the host: commands, scheduler, mixer, gain and the
+// output chain, rendered through the NullBackend
+
+void setUp() {}
+void tearDown() {
+    soundManager.stopMetronome();
+    AudioCapture::record(AUDIO_SAMPLE_RATE / 2); // Let the last click ring out
+}
+
+void test_clicks_reach_the_output() {
+    AudioCapture::start(AUDIO_SAMPLE_RATE * 4);
+    soundManager.startMetronome(120, 4);
+    TEST_ASSERT_TRUE(AudioCapture::wait());
+
+    std::vector<size_t> clicks = AudioCapture::onsets(AudioCapture::samples);
+    TEST_ASSERT_INT_WITHIN(1, 8, clicks.size()); // 2 per second
+    TEST_ASSERT_GREATER_THAN(8000, AudioCapture::peak(AudioCapture::samples));
+}
+
+void test_stop_goes_quiet() {
+    soundManager.startMetronome(200, 4);
+    AudioCapture::record(AUDIO_SAMPLE_RATE);
+    soundManager.stopMetronome();
+    AudioCapture::record(AUDIO_SAMPLE_RATE / 2);
+    AudioCapture::record(AUDIO_SAMPLE_RATE);
+    TEST_ASSERT_EQUAL(0, AudioCapture::onsets(AudioCapture::samples).size());
+    TEST_ASSERT_LESS_THAN(64, AudioCapture::peak(AudioCapture::samples));
+}
+
+void test_volume_scales_the_output() {
+    soundManager.setVolume(255);
+    soundManager.startMetronome(60, 1);
+    int32_t loud = AudioCapture::peak(AudioCapture::record(AUDIO_SAMPLE_RATE * 2));
+    soundManager.setVolume(0);
+    AudioCapture::record(AUDIO_BLOCK_FRAMES * 4); // Ramp to the new level
+    int32_t muted = AudioCapture::peak(AudioCapture::record(AUDIO_SAMPLE_RATE * 2));
+    soundManager.setVolume(255);
+
+    TEST_ASSERT_GREATER_THAN(8000, loud);
+    TEST_ASSERT_EQUAL(0, muted);
+}
+
+int main() {
+    AudioCapture::begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_clicks_reach_the_output);
+    RUN_TEST(test_stop_goes_quiet);
+    RUN_TEST(test_volume_scales_the_output);
+    return UNITY_END();
+}
@@ -0,0 +1,84 @@
+#include <unity.h>
+#include "../AudioCapture.h"
+
+// Beats are counted in output samples: beat k starts exactly
+// floor(k * AUDIO_SAMPLE_RATE * 60 / bpm) samples after the first one,
+// however long the metronome runs. Checked on the rendered output.
+
+static const uint64_t samplesPerMinute = (uint64_t)AUDIO_SAMPLE_RATE * 60;
+
+void setUp() {}
+void tearDown() {
+    soundManager.stopMetronome();
+    AudioCapture::record(AUDIO_SAMPLE_RATE); // Let the last click ring out
+}
+
+// Largest distance, in samples, between the clicks heard and the exact beat grid
+static int64_t gridError(const std::vector<size_t>& clicks, int bpm) {
+    int64_t worst = 0;
+    for (size_t k = 0; k < clicks.size(); k++) {
+        int64_t expected = (int64_t)(k * samplesPerMinute / bpm);
+        int64_t error = (int64_t)(clicks[k] - clicks[0]) - expected;
+        if (error < 0) error = -error;
+        if (error > worst) worst = error;
+    }
+    return worst;
+}
+
+// Every click (1 beat per bar: the same sound each time) on its exact sample
+static void checkTempo(int bpm, size_t beats) {
+    // Recording starts before the metronome, so the first click is beat 0
+    size_t frames = (size_t)((beats * samplesPerMinute + bpm - 1) / bpm) + AUDIO_SAMPLE_RATE / 2;
+    AudioCapture::start(frames);
+    soundManager.startMetronome(bpm, 1);
+    TEST_ASSERT_TRUE(AudioCapture::wait());
+
+    std::vector<size_t> clicks = AudioCapture::onsets(AudioCapture::samples, true);
+    TEST_ASSERT_GREATER_OR_EQUAL(beats, clicks.size());
+    clicks.resize(beats);
+    TEST_ASSERT_EQUAL(0, gridError(clicks, bpm));
+}
+
+void test_whole_interval_120() { checkTempo(120, 16); }      // 22050 samples
+void test_fractional_interval_130() { checkTempo(130, 64); } // 20353.85 samples (millis(): 461 ms, 20330)
+void test_fractional_interval_97() { checkTempo(97, 64); }   // 27278.35 samples
+
+// The exact fraction never drifts: after 1000 beats the last click is still
+// on the grid. A rounded interval (9220) would be 490 samples late by then.
+void test_no_drift_over_1000_beats() {
+    checkTempo(287, 1000); // 9219.51 samples
+}
+
+// A tempo change keeps the click on the output sample grid of the new tempo
+void test_tempo_change_restarts_the_grid() {
+    soundManager.startMetronome(100, 1);
+    AudioCapture::record(AUDIO_SAMPLE_RATE * 2);
+    soundManager.setTempo(151, 1);
+    AudioCapture::record(AUDIO_SAMPLE_RATE * 2); // The beat in progress finishes at the old tempo
+
+    std::vector<int16_t>& audio = AudioCapture::record(AUDIO_SAMPLE_RATE * 12);
+    std::vector<size_t> clicks = AudioCapture::onsets(audio);
+    TEST_ASSERT_GREATER_OR_EQUAL(29, clicks.size());
+    // Only the spacing is checked: where in its fraction the grid continues
+    // depends on when the change arrived
+    const uint32_t interval = samplesPerMinute / 151; // 17523.18
+    for (size_t k = 1; k < clicks.size(); k++) {
+        uint32_t gap = clicks[k] - clicks[k - 1];
+        TEST_ASSERT_TRUE(gap == interval || gap == interval + 1);
+    }
+    int64_t span = clicks.back() - clicks.front();
+    int64_t exact = (int64_t)((clicks.size() - 1) * samplesPerMinute / 151);
+    TEST_ASSERT_INT_WITHIN(1, exact, span);
+}
+
+int main() {
+    AudioCapture::begin();
+    soundManager.setOutputChain(false); // Raw mix: every click has the same shape
+    UNITY_BEGIN();
+    RUN_TEST(test_whole_interval_120);
+    RUN_TEST(test_fractional_interval_130);
+    RUN_TEST(test_fractional_interval_97);
+    RUN_TEST(test_no_drift_over_1000_beats);
+    RUN_TEST(test_tempo_change_restarts_the_grid);
+    return UNITY_END();
+}
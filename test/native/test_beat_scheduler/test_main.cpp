@@ -0,0 +1,280 @@
+#include <unity.h>
+#include "BeatScheduler.h"
+
+// BeatScheduler on its own, without the mixer task: beat positions are plain
+// sample numbers, so pause, resume and jumps can be checked to the sample.
+
+static const uint64_t samplesPerMinute = (uint64_t)AUDIO_SAMPLE_RATE * 60;
+
+void setUp() {}
+void tearDown() {}
+
+// Plays `count` beats, returns where the next one lands
+static uint64_t play(BeatScheduler& clock, size_t count) {
+    for (size_t i = 0; i < count; i++) clock.advance();
+    return clock.nextOnset();
+}
+
+// Steps of 2, 1 and 3 bars: 120 bpm 4/4, 90 bpm 3/4, 150 bpm 2/4
+static std::vector<SequenceStep> threeSteps() {
+    return {{2, 4, 120, 0, RAMP_LINEAR}, {1, 3, 90, 0, RAMP_LINEAR}, {3, 2, 150, 0, RAMP_LINEAR}};
+}
+
+// A pause holds the distance to the next beat: after the resume, every beat
+// lands exactly where an unpaused clock started that much later puts it
+void test_resume_keeps_the_beat_phase() {
+    const uint32_t held = 123457;
+    BeatScheduler clock, reference;
+    clock.start(1000, 130, 4);
+    reference.start(1000 + held, 130, 4);
+
+    uint64_t next = play(clock, 6);
+    play(reference, 6);
+    clock.pause(next - 5000); // Mid-beat
+    TEST_ASSERT_FALSE(clock.isRunning());
+    TEST_ASSERT_TRUE(clock.isPaused());
+
+    clock.resume(next - 5000 + held);
+    TEST_ASSERT_TRUE(clock.isRunning());
+    TEST_ASSERT_EQUAL_UINT32(5000, (uint32_t)(clock.nextOnset() - (next - 5000 + held)));
+    TEST_ASSERT_EQUAL(2, clock.beatInBar());
+    for (int k = 0; k < 100; k++) {
+        TEST_ASSERT_EQUAL_UINT32((uint32_t)reference.nextOnset(), (uint32_t)clock.nextOnset());
+        TEST_ASSERT_EQUAL(reference.beatInBar(), clock.beatInBar());
+        clock.advance();
+        reference.advance();
+    }
+}
+
+// Paused right on a beat: it is still due the moment playback resumes
+void test_resume_on_the_beat() {
+    BeatScheduler clock;
+    clock.start(0, 97, 3);
+    uint64_t next = play(clock, 4);
+    clock.pause(next);
+    clock.resume(next + 44100);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(next + 44100), (uint32_t)clock.nextOnset());
+    clock.advance();
+    TEST_ASSERT_EQUAL_UINT32(samplesPerMinute * 5 / 97 - samplesPerMinute * 4 / 97, (uint32_t)(clock.nextOnset() - (next + 44100)));
+}
+
+// The same for a program: bar, step and the program's own grid carry on
+void test_resume_keeps_the_program_phase() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile(threeSteps(), AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(500, &program, false);
+
+    uint64_t next = play(clock, 9); // Beat 1 of step 1 (90 bpm)
+    clock.pause(next - 7);
+    clock.resume(next - 7 + 30000);
+    TEST_ASSERT_EQUAL_UINT32(7, (uint32_t)(clock.nextOnset() - (next - 7 + 30000)));
+    TEST_ASSERT_EQUAL(1, clock.currentBar()->step);
+    TEST_ASSERT_EQUAL(1, clock.beatInBar());
+
+    // Every later downbeat is on the compiled grid, moved by the pause
+    play(clock, 2);
+    for (size_t bar = 3; bar < program.size(); bar++) {
+        TEST_ASSERT_EQUAL_UINT32(500 + 30000 + program.bar(bar).start, (uint32_t)clock.nextOnset());
+        TEST_ASSERT_EQUAL_UINT32(500 + 30000, (uint32_t)clock.programStart());
+        play(clock, program.bar(bar).beats);
+    }
+    TEST_ASSERT_FALSE(clock.isRunning()); // Played once
+}
+
+// While paused, a jump moves straight to the bar: its downbeat is the first
+// beat after the resume
+void test_jump_while_paused() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile(threeSteps(), AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(0, &program, true);
+
+    uint64_t next = play(clock, 3);
+    clock.pause(next - 100);
+    clock.jumpTo(program.barOf(2, 1));
+    clock.jumpTo(program.size()); // No such bar: ignored
+    clock.resume(next - 100 + 8000);
+
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(next - 100 + 8000), (uint32_t)clock.nextOnset());
+    TEST_ASSERT_EQUAL(2, clock.currentBar()->step);
+    TEST_ASSERT_EQUAL(1, clock.currentBar()->barInStep);
+    TEST_ASSERT_EQUAL(0, clock.beatInBar());
+    TEST_ASSERT_TRUE(clock.accented());
+
+    // The bar plays at its own tempo, then the program goes on from there
+    uint64_t downbeat = clock.nextOnset();
+    play(clock, 2);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(samplesPerMinute * 2 / 150), (uint32_t)(clock.nextOnset() - downbeat));
+    TEST_ASSERT_EQUAL(2, clock.currentBar()->barInStep);
+}
+
+// While running, a jump waits for the end of the bar: the beats already on
+// the grid stay where they are
+void test_jump_while_running() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile(threeSteps(), AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(0, &program, true);
+
+    play(clock, 1);
+    clock.jumpTo(program.barOf(1, 0));
+    uint64_t barEnd = play(clock, 3); // Rest of bar 0
+    TEST_ASSERT_EQUAL_UINT32(program.bar(1).start, (uint32_t)barEnd);
+    TEST_ASSERT_EQUAL(1, clock.currentBar()->step);
+    TEST_ASSERT_EQUAL(0, clock.beatInBar());
+
+    // The program's grid now runs from that downbeat: the step after it
+    // starts where the compiled bars put it
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)barEnd, (uint32_t)(clock.programStart() + program.bar(2).start));
+    uint64_t stepEnd = play(clock, 3);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(clock.programStart() + program.bar(3).start), (uint32_t)stepEnd);
+    TEST_ASSERT_EQUAL(2, clock.currentBar()->step);
+}
+
+// Steady steps, a ramp and a slow step: bars of very different lengths
+static std::vector<SequenceStep> mixedSteps() {
+    return {{3, 4, 120, 0, RAMP_LINEAR}, {4, 3, 80, 160, RAMP_LINEAR}, {2, 7, 61, 0, RAMP_LINEAR}, {5, 2, 200, 100, RAMP_EXPONENTIAL}};
+}
+
+// What barAt() answers, the slow way
+static size_t scanBar(const Timeline& program, uint32_t position) {
+    size_t found = 0;
+    for (size_t i = 0; i < program.size(); i++) {
+        if (program.bar(i).start <= position) found = i;
+    }
+    return found;
+}
+
+// The binary search finds the bar playing at any position, including the
+// first and last sample of each bar, before the start and past the end
+void test_bar_at_any_position() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile(mixedSteps(), AUDIO_SAMPLE_RATE));
+    TEST_ASSERT_EQUAL(14, program.size());
+
+    for (size_t i = 0; i < program.size(); i++) {
+        uint32_t start = program.bar(i).start;
+        uint32_t end = i + 1 < program.size() ? program.bar(i + 1).start : program.length();
+        TEST_ASSERT_EQUAL(i, program.barAt(start));
+        TEST_ASSERT_EQUAL(i, program.barAt(end - 1));
+        TEST_ASSERT_EQUAL(i, program.barAt(start + (end - start) / 2));
+    }
+    TEST_ASSERT_EQUAL(program.size() - 1, program.barAt(program.length() + 44100));
+    for (uint32_t position = 0; position < program.length(); position += 997) {
+        TEST_ASSERT_EQUAL(scanBar(program, position), program.barAt(position));
+    }
+}
+
+// Seeking back, as CMD_SEEK does: from the next beat's place in the program
+// (nextOnset - programStart) to the bar playing that much earlier. It takes
+// over at the next downbeat, like a jump.
+void test_seek_back_to_the_bar_playing_then() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile(mixedSteps(), AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(2000, &program, true);
+
+    play(clock, 12 + 12 + 9); // Into step 2 (7/4 at 61 bpm)
+    uint32_t position = (uint32_t)(clock.nextOnset() - clock.programStart());
+    size_t target = program.barAt(position - 10 * AUDIO_SAMPLE_RATE);
+    TEST_ASSERT_EQUAL(scanBar(program, position - 10 * AUDIO_SAMPLE_RATE), target);
+    TEST_ASSERT_LESS_THAN(program.barAt(position), target);
+    clock.jumpTo(target);
+
+    while (clock.beatInBar() != 0) clock.advance();
+    TEST_ASSERT_EQUAL(program.bar(target).step, clock.currentBar()->step);
+    TEST_ASSERT_EQUAL(program.bar(target).barInStep, clock.currentBar()->barInStep);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)clock.nextOnset(), (uint32_t)(clock.programStart() + program.bar(target).start));
+}
+
+// Intervals between the next `count` beats
+static std::vector<uint32_t> intervals(BeatScheduler& clock, size_t count) {
+    std::vector<uint32_t> gaps;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t at = clock.nextOnset();
+        clock.advance();
+        gaps.push_back((uint32_t)(clock.nextOnset() - at));
+    }
+    return gaps;
+}
+
+// Beat k of a linear ramp plays at from + k * (to - from) / (beats - 1) bpm:
+// its interval is within a sample of a minute divided by that
+void test_linear_ramp_reaches_the_end_tempo() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile({{4, 4, 100, 180, RAMP_LINEAR}, {1, 4, 180, 0, RAMP_LINEAR}}, AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(0, &program, false);
+
+    std::vector<uint32_t> gaps = intervals(clock, 16);
+    for (size_t k = 0; k < gaps.size(); k++) {
+        double bpm = k < 15 ? 100 + k * 80.0 / 15 : 180;
+        TEST_ASSERT_INT_WITHIN(1, (int32_t)(samplesPerMinute / bpm), (int32_t)gaps[k]);
+        if (k > 0) TEST_ASSERT_LESS_OR_EQUAL(gaps[k - 1], gaps[k]);
+    }
+    TEST_ASSERT_EQUAL(1, clock.currentBar()->step); // The steady step right after
+}
+
+// An exponential ramp changes every interval by the same ratio
+void test_exponential_ramp_keeps_the_ratio() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile({{2, 4, 200, 100, RAMP_EXPONENTIAL}, {1, 1, 100, 0, RAMP_LINEAR}}, AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(0, &program, false);
+
+    double ratio = pow(2.0, 1.0 / 7); // 200 to 100 bpm over 7 intervals
+    std::vector<uint32_t> gaps = intervals(clock, 7);
+    for (size_t k = 0; k < gaps.size(); k++) {
+        TEST_ASSERT_INT_WITHIN(1, (int32_t)(samplesPerMinute / 200.0 * pow(ratio, k)), (int32_t)gaps[k]);
+    }
+    TEST_ASSERT_INT_WITHIN(1, (int32_t)(samplesPerMinute / 100), (int32_t)gaps.back() * ratio);
+}
+
+// Tempo changing by more than a quarter per beat plays exponentially (a
+// linear step that large would need more Newton steps than the mixer runs)
+void test_steep_linear_ramp_plays_exponentially() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile({{1, 4, 40, 200, RAMP_LINEAR}}, AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(0, &program, false);
+
+    std::vector<uint32_t> gaps = intervals(clock, 3);
+    double ratio = pow(40.0 / 200, 1.0 / 3);
+    for (size_t k = 0; k < gaps.size(); k++) {
+        TEST_ASSERT_INT_WITHIN(1, (int32_t)(samplesPerMinute / 40.0 * pow(ratio, k)), (int32_t)gaps[k]);
+    }
+}
+
+// The compiler walks a ramp with the scheduler's arithmetic: every downbeat
+// played is exactly on the bar start compiled for it, to the last bar
+void test_ramp_downbeats_match_the_compiled_bars() {
+    Timeline program;
+    TEST_ASSERT_TRUE(program.compile(mixedSteps(), AUDIO_SAMPLE_RATE));
+    BeatScheduler clock;
+    clock.start(777, &program, false);
+
+    for (size_t bar = 0; bar < program.size(); bar++) {
+        TEST_ASSERT_EQUAL(bar, program.barOf(clock.currentBar()->step, clock.currentBar()->barInStep));
+        TEST_ASSERT_EQUAL_UINT32(777 + program.bar(bar).start, (uint32_t)clock.nextOnset());
+        play(clock, program.bar(bar).beats);
+    }
+    TEST_ASSERT_EQUAL_UINT32(777 + program.length(), (uint32_t)clock.nextOnset());
+    TEST_ASSERT_FALSE(clock.isRunning());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_resume_keeps_the_beat_phase);
+    RUN_TEST(test_resume_on_the_beat);
+    RUN_TEST(test_resume_keeps_the_program_phase);
+    RUN_TEST(test_jump_while_paused);
+    RUN_TEST(test_jump_while_running);
+    RUN_TEST(test_bar_at_any_position);
+    RUN_TEST(test_seek_back_to_the_bar_playing_then);
+    RUN_TEST(test_linear_ramp_reaches_the_end_tempo);
+    RUN_TEST(test_exponential_ramp_keeps_the_ratio);
+    RUN_TEST(test_steep_linear_ramp_plays_exponentially);
+    RUN_TEST(test_ramp_downbeats_match_the_compiled_bars);
+    return UNITY_END();
+}